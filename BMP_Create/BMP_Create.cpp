@@ -1,5 +1,6 @@
 #include <SFML/Graphics.hpp>
 #include <SFML/Audio.hpp>
+#include <SFML/Network.hpp>
 #include <vector>
 #include <cmath>
 #include <iostream>
@@ -7,40 +8,181 @@
 #include <chrono>
 #include <cstdlib>
 #include <ctime>
+#include <string>
+#include <atomic>
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <functional>
+#include <cstdio>
+#include <new>
+#include <type_traits>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <iterator>
+#include "BMP_Create.h"
+#include "Mandelbulb.h"
+#include "Ecs.h"
+#include "Bundle.h"
+
+// SSE2 span filling in the software rasterizer (always there on x64)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_SSE2 1
+#include <emmintrin.h>
+#else
+#define RASTER_SSE2 0
+#endif
+
+// Balls per step of the ball kernel: 8 with AVX (/arch:AVX or -mavx), 4 with SSE2, else scalar
+#if defined(__AVX__)
+#define BALLS_SIMD 8
+#include <immintrin.h>
+#elif RASTER_SSE2
+#define BALLS_SIMD 4
+#else
+#define BALLS_SIMD 0
+#endif
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#include <malloc.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+// Global allocation counters, so the benchmark can prove a steady-state frame
+// never touches the heap. Counting replaces operator new, so it is on in debug builds
+// only; build with TRACK_ALLOCATIONS=1 or 0 to choose either way.
+#ifndef TRACK_ALLOCATIONS
+#ifdef NDEBUG
+#define TRACK_ALLOCATIONS 0
+#else
+#define TRACK_ALLOCATIONS 1
+#endif
+#endif
+
+std::atomic<long long> totalAllocations(0);
+std::atomic<long long> totalAllocatedBytes(0);
+thread_local long long threadAllocations = 0;
+
+#if TRACK_ALLOCATIONS
+void countAllocation(std::size_t size) {
+    ++threadAllocations;
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    totalAllocatedBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+}
 
-// Level properties
-const int Level = 0;
-int currentLevel = Level;
+void* operator new(std::size_t size) {
+    countAllocation(size);
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
 
-const int brickColumns = 10;
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
 
-std::vector<sf::RectangleShape> bricks; // Container of bricks
+// Over-aligned types (alignas above the default, such as cache-line sized shards)
+// come through these from C++17 on, and count the same
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    countAllocation(size);
+    const std::size_t align = std::max(sizeof(void*), static_cast<std::size_t>(alignment));
+#ifdef _WIN32
+    void* memory = _aligned_malloc(size ? size : 1, align);
+#else
+    void* memory = nullptr;
+    if (posix_memalign(&memory, align, size ? size : 1) != 0) memory = nullptr;
+#endif
+    if (memory) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept {
+    operator delete(memory, alignment);
+}
+#endif
+#endif
+
+// Bump allocator for short-lived scratch data. Memory is handed out from one
+// block and given back all at once when the enclosing Scope ends.
+class FrameArena {
+public:
+    explicit FrameArena(size_t capacity) : memory(new unsigned char[capacity]), capacity(capacity) {}
+    ~FrameArena() { delete[] memory; }
+
+    // Nothing is destroyed on rewind, so only plain data belongs here
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+        size_t start = (used + alignof(T) - 1) & ~(alignof(T) - 1);
+        if (start + count * sizeof(T) > capacity) throw std::bad_alloc();
+        used = start + count * sizeof(T);
+        T* items = reinterpret_cast<T*>(memory + start);
+        for (size_t i = 0; i < count; ++i) new (items + i) T();
+        return items;
+    }
 
-// Define Debris before using it in a vector
-struct Debris {
-    sf::RectangleShape shape;
-    sf::Vector2f velocity;
-    float lifetime;
-    float rotationSpeed;
+    // Rewinds the arena to where it was when the scope was opened
+    class Scope {
+    public:
+        explicit Scope(FrameArena& arena) : arena(arena), mark(arena.used) {}
+        ~Scope() { arena.used = mark; }
+
+    private:
+        FrameArena& arena;
+        size_t mark;
+    };
+
+private:
+    unsigned char* memory;
+    size_t capacity;
+    size_t used = 0;
 };
 
-std::vector<Debris> debris;
+FrameArena scratch(64 * 1024); // Banner scratch space
+
+// Level properties
+const int Level = 0;
+
+const int brickColumns = 10;
+const float brickWidth = 60.0f;
+const float brickHeight = 20.0f;
 
 const int brickRows = 3;
-int currentbrickRows = brickRows;
 
 const int maxBalls = 2;
-int remainingBalls = maxBalls;
 
 const int brickHitDebris = 10;
 
-sf::Clock levelClock;
-sf::Clock debrisClock;
+// Paddle and ball properties
+const float paddleWidth = 200.0f;
+const float paddleHeight = 20.0f;
+const float paddleSpeed = 7.0f;
+const float ballRadius = 10.0f;
 
-// Initialize variables for staggered brick falling
-bool lastRowFalling = false;
-size_t currentBrickIndex = bricks.size() - brickColumns; // Start from the first brick in the last row
-sf::Clock brickFallClock; // Separate clock for brick falling timing
+// The simulation advances in fixed 60 Hz frames (ball velocities are per frame)
+const float frameTime = 1.0f / 60.0f;
+
+sf::Clock debrisClock;
 
 // Helper function for ball collision remains unchanged
 void resolveCollision(sf::Vector2f& pos1, sf::Vector2f& vel1, sf::Vector2f& pos2, sf::Vector2f& vel2, float radius) {
@@ -68,453 +210,3577 @@ void resolveCollision(sf::Vector2f& pos1, sf::Vector2f& vel1, sf::Vector2f& pos2
     }
 }
 
+// Debris particles are ECS entities; each component is one plain array per archetype
+struct Position { sf::Vector2f value; };
+struct Velocity { sf::Vector2f value; };
+struct Spin { float rotation; float speed; }; // Degrees, and turns per second
+struct Look { float size; sf::Color color; };
+struct Lifetime { float seconds; };
+
+const size_t maxDebris = 2048;
+const size_t parallelDebris = 16384; // Below this the systems are too short to be worth waking workers
+
+// The debris entities and the systems that move, spin, age and fade them
+class DebrisField {
+public:
+    // The widest stage has three systems, so two workers plus the caller cover it
+    explicit DebrisField(size_t capacity = maxDebris) : capacity(capacity), scheduler(3) {
+        registry.reserve<Position, Velocity, Spin, Look, Lifetime>(capacity);
+
+        scheduler.add("motion", 0, componentMask<Position, Velocity>(), [this](Registry& r, CommandBuffer&) {
+            r.eachArchetype<Position, Velocity>([this](size_t count, const Entity*, Position* position, Velocity* velocity) {
+                for (size_t i = 0; i < count; ++i) {
+                    position[i].value += velocity[i].value * deltaTime;
+                    velocity[i].value.y += 50.f * deltaTime; // Gravity
+                }
+            });
+        });
+        scheduler.add("spin", 0, componentMask<Spin>(), [this](Registry& r, CommandBuffer&) {
+            r.eachArchetype<Spin>([this](size_t count, const Entity*, Spin* spin) {
+                for (size_t i = 0; i < count; ++i) {
+                    spin[i].rotation = std::fmod(spin[i].rotation + spin[i].speed * 360 * deltaTime, 360.0f);
+                }
+            });
+        });
+        scheduler.add("age", 0, componentMask<Lifetime>(), [this](Registry& r, CommandBuffer& commands) {
+            r.eachArchetype<Lifetime>([&](size_t count, const Entity* entities, Lifetime* lifetime) {
+                for (size_t i = 0; i < count; ++i) {
+                    lifetime[i].seconds -= deltaTime;
+                    if (lifetime[i].seconds <= 0) commands.destroy(entities[i]);
+                }
+            });
+        });
+        // Reads the aged lifetimes, so it runs in the stage after "age"
+        scheduler.add("fade", componentMask<Lifetime>(), componentMask<Look>(), [this](Registry& r, CommandBuffer&) {
+            r.eachArchetype<const Lifetime, Look>([this](size_t count, const Entity*, const Lifetime* lifetime, Look* look) {
+                for (size_t i = 0; i < count; ++i) {
+                    float alpha = look[i].color.a;
+                    if (alpha > 0) {
+                        alpha -= 255 * deltaTime / lifetime[i].seconds;
+                        if (alpha < 0) alpha = 0;
+                        look[i].color.a = static_cast<sf::Uint8>(alpha);
+                    }
+                }
+            });
+        });
+        // Room for every particle to expire in one frame
+        scheduler.reserveCommands(capacity * (1 + sizeof(Entity)));
+    }
+
+    bool full() const { return registry.size() >= capacity; }
+
+    // Returns false when the field is full
+    bool spawn(const Position& position, const Velocity& velocity, const Spin& spin, const Look& look, const Lifetime& lifetime) {
+        if (registry.size() >= capacity) return false;
+        registry.create(position, velocity, spin, look, lifetime);
+        return true;
+    }
+
+    void update(float dt, bool parallel) {
+        deltaTime = dt;
+        scheduler.run(registry, parallel);
+    }
+
+    template <typename F>
+    void each(F&& f) const {
+        registry.each<Position, Spin, Look>(std::forward<F>(f));
+    }
+
+    void printPlan(std::ostream& out) const { scheduler.printPlan(out); }
+
+    size_t size() const { return registry.size(); }
+    void clear() { registry.clear(); }
+
+private:
+    size_t capacity;
+    Registry registry;
+    SystemScheduler scheduler;
+    float deltaTime = 0;
+};
+
+DebrisField debris;
+
 // Function to spawn debris with explosion-like characteristics
-void spawnDebris(std::vector<Debris>& debris, sf::Vector2f position, int count) {
+void spawnDebris(DebrisField& debris, sf::Vector2f position, int count) {
     for (int i = 0; i < count; ++i) {
-        Debris d;
+        // Stop before drawing anything, so a full field leaves the random sequence alone
+        if (debris.full()) return;
 
         // Random size for varied particle look
         float size = 2.f + (std::rand() % 8); // Size between 2 and 10
-        d.shape.setSize(sf::Vector2f(size, size));
 
         // Color variation (simple example, could be more complex with gradients)
         int colorVariation = std::rand() % 100;
-        d.shape.setFillColor(sf::Color(255 - colorVariation, 255 - colorVariation / 2, 0)); // From yellow to orange
-
-        d.shape.setPosition(position);
+        sf::Color color(255 - colorVariation, 255 - colorVariation / 2, 0); // From yellow to orange
 
         // Direction of velocity is radially outward with some randomness
         float angle = (std::rand() % 360) * (3.14159f / 180.0f); // Convert to radians
         float speed = 50.f + (std::rand() % 150); // Speed between 50 and 200
-        d.velocity = sf::Vector2f(std::cos(angle) * speed, std::sin(angle) * speed);
+        sf::Vector2f velocity(std::cos(angle) * speed, std::sin(angle) * speed);
 
         // Lifetime variation
-        d.lifetime = 0.5f + (std::rand() % 100) / 100.f; // Lifetime between 0.5 and 1.5 seconds
+        float lifetime = 0.5f + (std::rand() % 100) / 100.f; // Lifetime between 0.5 and 1.5 seconds
 
         // Add rotation for dynamic look
-        d.shape.setRotation(std::rand() % 360); // Random initial rotation
-        d.rotationSpeed = (std::rand() % 100 - 50) / 50.0f; // Rotation speed between -1 and 1
+        float rotation = static_cast<float>(std::rand() % 360); // Random initial rotation
+        float rotationSpeed = (std::rand() % 100 - 50) / 50.0f; // Rotation speed between -1 and 1
 
-        debris.push_back(d);
+        debris.spawn(Position{ position }, Velocity{ velocity }, Spin{ rotation, rotationSpeed }, Look{ size, color }, Lifetime{ lifetime });
     }
 }
 
 // Function to update debris
-void updateDebris(std::vector<Debris>& debris, float deltaTime) {
-    for (auto it = debris.begin(); it != debris.end();) {
-        // Update position
-        it->shape.move(it->velocity * deltaTime);
+void updateDebris(DebrisField& debris, float deltaTime) {
+    debris.update(deltaTime, debris.size() >= parallelDebris);
+}
+
+// Everything the game draws. The SFML window is one implementation; a software
+// rasterizer is the other, for machines with no display or GPU.
+class RenderBackend {
+public:
+    virtual ~RenderBackend() {}
+
+    virtual void clear(sf::Color color) = 0;
+    virtual void rect(sf::Vector2f position, sf::Vector2f size, sf::Color color) = 0;
+    // Rotated about its top-left corner, like an sf::RectangleShape with no origin
+    virtual void rotatedRect(sf::Vector2f position, sf::Vector2f size, float degrees, sf::Color color) = 0;
+    virtual void circle(sf::Vector2f center, float radius, sf::Color color) = 0;
+    virtual void text(sf::Vector2f position, const char* string, unsigned characterSize, sf::Color color) = 0;
+    virtual void glyph(char c, sf::Vector2f position, unsigned characterSize, sf::Color color) = 0;
+    // RGBA image scaled up from position; `changed` says the pixels differ from last time
+    virtual void image(const sf::Uint8* rgba, int width, int height, sf::Vector2f position, sf::Vector2f scale, bool changed) = 0;
+    virtual void display() = 0;
+    // Banners pace their animations with this; headless backends don't wait
+    virtual void hold(int milliseconds) = 0;
+};
+
+// Function to render debris
+void renderDebris(RenderBackend& renderer, const DebrisField& debris) {
+    debris.each([&](Entity, const Position& position, const Spin& spin, const Look& look) {
+        renderer.rotatedRect(position.value, sf::Vector2f(look.size, look.size), spin.rotation, look.color);
+    });
+}
 
-        // Apply gravity
-        it->velocity.y += 50.f * deltaTime;
+// Whole simulation ticks in a span of seconds
+long long ticksFor(float seconds) {
+    return std::llround(seconds / frameTime);
+}
+
+// Things that happen at a set simulation tick
+enum class TimedEventType {
+    StartRowFall, // The last row starts falling 7 seconds into a level
+    DropBrick     // Drop the next falling brick
+};
+
+struct TimedEvent {
+    long long tick;
+    TimedEventType type;
+    unsigned sequence; // Keeps events due at the same time in the order they were queued
+};
+
+// Min-heap of timed events on simulation ticks. Each event is queued once and
+// popped when it is due, instead of polling clocks inside the ball loop.
+class EventScheduler {
+public:
+    EventScheduler() {
+        events.reserve(8); // A level queues at most a couple of timers at once
+    }
+
+    void schedule(long long tick, TimedEventType type) {
+        events.push_back(TimedEvent{ tick, type, nextSequence++ });
+        std::push_heap(events.begin(), events.end(), Later());
+    }
+
+    // Take the earliest event if it is due by `now`
+    bool popDue(long long now, TimedEvent& event) {
+        if (events.empty() || events.front().tick > now) return false;
+        std::pop_heap(events.begin(), events.end(), Later());
+        event = events.back();
+        events.pop_back();
+        return true;
+    }
 
-        // Reduce lifetime
-        it->lifetime -= deltaTime;
+    void clear() {
+        events.clear();
+    }
 
-        // Particle rotation
-        it->shape.rotate(it->rotationSpeed * 360 * deltaTime); // Rotate based on speed
+    size_t size() const {
+        return events.size();
+    }
 
-        // Fade out effect
-        float alpha = it->shape.getFillColor().a;
-        if (alpha > 0) {
-            alpha -= 255 * deltaTime / it->lifetime; // Adjust this for speed of fade
-            if (alpha < 0) alpha = 0;
-            sf::Color newColor = it->shape.getFillColor();
-            newColor.a = static_cast<sf::Uint8>(alpha);
-            it->shape.setFillColor(newColor);
+private:
+    struct Later {
+        bool operator()(const TimedEvent& a, const TimedEvent& b) const {
+            return a.tick > b.tick || (a.tick == b.tick && a.sequence > b.sequence);
         }
-        if (it->lifetime <= 0) {
-            it = debris.erase(it);
+    };
+
+    std::vector<TimedEvent> events;
+    unsigned nextSequence = 0;
+};
+
+const int reservedBrickRows = 16;
+
+// A brick is just a position and a colour slot; the renderer owns the shape
+struct Brick {
+    sf::Vector2f position;
+    int colorIndex;
+    int slot; // row * brickColumns + column in the level layout; stays put when bricks before it go
+};
+
+// Where the brick in a layout slot starts out
+sf::Vector2f brickHome(int slot) {
+    int row = slot / brickColumns, col = slot % brickColumns;
+    return sf::Vector2f(10 + col * (brickWidth + 5), 50 + row * (brickHeight + 5));
+}
+
+// Balls as separate x and y arrays, so the kernel below can load several at once
+struct BallSet {
+    std::vector<float> x, y;
+    std::vector<float> vx, vy; // Per frame, before the level's speed multiplier
+
+    size_t size() const { return x.size(); }
+    bool empty() const { return x.empty(); }
+
+    void reserve(size_t count) {
+        x.reserve(count);
+        y.reserve(count);
+        vx.reserve(count);
+        vy.reserve(count);
+    }
+
+    void push(sf::Vector2f position, sf::Vector2f velocity) {
+        x.push_back(position.x);
+        y.push_back(position.y);
+        vx.push_back(velocity.x);
+        vy.push_back(velocity.y);
+    }
+
+    sf::Vector2f position(size_t i) const { return sf::Vector2f(x[i], y[i]); }
+    sf::Vector2f velocity(size_t i) const { return sf::Vector2f(vx[i], vy[i]); }
+};
+
+int countBits(int mask) {
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+}
+
+// Move every ball one frame and bounce it off the walls and the paddle. The SIMD paths
+// do the same arithmetic on BALLS_SIMD balls at a time and apply the bounces through
+// lane masks instead of branches, so they give exactly the scalar results.
+// Returns the number of paddle hits.
+int moveBalls(BallSet& balls, float speed, sf::Vector2f paddle, bool simd = true) {
+    float* x = balls.x.data();
+    float* y = balls.y.data();
+    float* vx = balls.vx.data();
+    float* vy = balls.vy.data();
+    const size_t count = balls.size();
+    const float paddleRight = paddle.x + paddleWidth;
+    const float restingY = paddle.y - ballRadius;
+    int hits = 0;
+    size_t i = 0;
+
+#if BALLS_SIMD == 8
+    if (simd) {
+        const __m256 radius = _mm256_set1_ps(ballRadius), zero = _mm256_setzero_ps(), right = _mm256_set1_ps(800.0f);
+        const __m256 sign = _mm256_set1_ps(-0.0f), step = _mm256_set1_ps(speed);
+        const __m256 top = _mm256_set1_ps(paddle.y), left = _mm256_set1_ps(paddle.x), end = _mm256_set1_ps(paddleRight), rest = _mm256_set1_ps(restingY);
+        for (; i + 8 <= count; i += 8) {
+            __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i);
+            __m256 dx = _mm256_loadu_ps(vx + i), dy = _mm256_loadu_ps(vy + i);
+            px = _mm256_add_ps(px, _mm256_mul_ps(dx, step));
+            py = _mm256_add_ps(py, _mm256_mul_ps(dy, step));
+
+            __m256 wall = _mm256_or_ps(_mm256_cmp_ps(_mm256_sub_ps(px, radius), zero, _CMP_LT_OQ), _mm256_cmp_ps(_mm256_add_ps(px, radius), right, _CMP_GT_OQ));
+            dx = _mm256_xor_ps(dx, _mm256_and_ps(wall, sign));
+            dy = _mm256_xor_ps(dy, _mm256_and_ps(_mm256_cmp_ps(_mm256_sub_ps(py, radius), zero, _CMP_LT_OQ), sign));
+
+            __m256 hit = _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(py, radius), top, _CMP_GE_OQ),
+                         _mm256_and_ps(_mm256_cmp_ps(_mm256_add_ps(px, radius), left, _CMP_GE_OQ), _mm256_cmp_ps(_mm256_sub_ps(px, radius), end, _CMP_LE_OQ)));
+            py = _mm256_blendv_ps(py, rest, hit);
+            dy = _mm256_or_ps(dy, _mm256_and_ps(hit, sign)); // -|vy|: always upwards off the paddle
+            hits += countBits(_mm256_movemask_ps(hit));
+
+            _mm256_storeu_ps(x + i, px);
+            _mm256_storeu_ps(y + i, py);
+            _mm256_storeu_ps(vx + i, dx);
+            _mm256_storeu_ps(vy + i, dy);
         }
-        else {
-            ++it;
+    }
+#elif BALLS_SIMD == 4
+    if (simd) {
+        const __m128 radius = _mm_set1_ps(ballRadius), zero = _mm_setzero_ps(), right = _mm_set1_ps(800.0f);
+        const __m128 sign = _mm_set1_ps(-0.0f), step = _mm_set1_ps(speed);
+        const __m128 top = _mm_set1_ps(paddle.y), left = _mm_set1_ps(paddle.x), end = _mm_set1_ps(paddleRight), rest = _mm_set1_ps(restingY);
+        for (; i + 4 <= count; i += 4) {
+            __m128 px = _mm_loadu_ps(x + i), py = _mm_loadu_ps(y + i);
+            __m128 dx = _mm_loadu_ps(vx + i), dy = _mm_loadu_ps(vy + i);
+            px = _mm_add_ps(px, _mm_mul_ps(dx, step));
+            py = _mm_add_ps(py, _mm_mul_ps(dy, step));
+
+            __m128 wall = _mm_or_ps(_mm_cmplt_ps(_mm_sub_ps(px, radius), zero), _mm_cmpgt_ps(_mm_add_ps(px, radius), right));
+            dx = _mm_xor_ps(dx, _mm_and_ps(wall, sign));
+            dy = _mm_xor_ps(dy, _mm_and_ps(_mm_cmplt_ps(_mm_sub_ps(py, radius), zero), sign));
+
+            __m128 hit = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(py, radius), top),
+                         _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(px, radius), left), _mm_cmple_ps(_mm_sub_ps(px, radius), end)));
+            py = _mm_or_ps(_mm_and_ps(hit, rest), _mm_andnot_ps(hit, py));
+            dy = _mm_or_ps(dy, _mm_and_ps(hit, sign)); // -|vy|: always upwards off the paddle
+            hits += countBits(_mm_movemask_ps(hit));
+
+            _mm_storeu_ps(x + i, px);
+            _mm_storeu_ps(y + i, py);
+            _mm_storeu_ps(vx + i, dx);
+            _mm_storeu_ps(vy + i, dy);
         }
     }
-}
+#else
+    (void)simd;
+#endif
+
+    // Scalar: the leftover balls, or all of them
+    for (; i < count; ++i) {
+        x[i] += vx[i] * speed;
+        y[i] += vy[i] * speed;
+
+        // Ball collision with walls
+        if (x[i] - ballRadius < 0 || x[i] + ballRadius > 800) {
+            vx[i] = -vx[i];
+        }
+        if (y[i] - ballRadius < 0) {
+            vy[i] = -vy[i];
+        }
 
-// Function to render debris
-void renderDebris(sf::RenderWindow& window, const std::vector<Debris>& debris) {
-    for (const auto& d : debris) {
-        window.draw(d.shape);
+        // Ball collision with paddle
+        if (y[i] + ballRadius >= paddle.y && x[i] + ballRadius >= paddle.x && x[i] - ballRadius <= paddleRight) {
+            y[i] = restingY;
+            vy[i] = -std::abs(vy[i]);
+            ++hits;
+        }
     }
+    return hits;
 }
 
-// Function to reset the level with increased difficulty
-void resetLevel(std::vector<sf::RectangleShape>& bricks, const int brickRows, const int brickColumns, const float brickWidth, const float brickHeight, sf::Color brickColors[], float& ballSpeedMultiplier) {
-    bricks.clear();
-    currentLevel++;
-    currentbrickRows++;
-    remainingBalls++;
-    lastRowFalling = false; // Reset the falling state
-    levelClock.restart();  // Restart the timer
-
-    for (int row = 0; row < currentbrickRows; ++row) {
-        for (int col = 0; col < brickColumns; ++col) {
-            sf::RectangleShape brick(sf::Vector2f(brickWidth, brickHeight));
-            brick.setFillColor(brickColors[row % 5]);
-            brick.setPosition(10 + col * (brickWidth + 5), 50 + row * (brickHeight + 5));
-            bricks.push_back(brick);
-        }
+// Drop the balls that fell out of the bottom in a single pass, keeping the rest in order.
+// Most frames lose nothing, so the SIMD paths just race ahead to the first lost ball.
+// Returns how many were lost.
+size_t removeLostBalls(BallSet& balls, bool simd = true) {
+    float* x = balls.x.data();
+    float* y = balls.y.data();
+    float* vx = balls.vx.data();
+    float* vy = balls.vy.data();
+    const size_t count = balls.size();
+    size_t i = 0;
+
+#if BALLS_SIMD == 8
+    if (simd) {
+        const __m256 radius = _mm256_set1_ps(ballRadius), bottom = _mm256_set1_ps(600.0f);
+        while (i + 8 <= count && !_mm256_movemask_ps(_mm256_cmp_ps(_mm256_sub_ps(_mm256_loadu_ps(y + i), radius), bottom, _CMP_GT_OQ))) i += 8;
+    }
+#elif BALLS_SIMD == 4
+    if (simd) {
+        const __m128 radius = _mm_set1_ps(ballRadius), bottom = _mm_set1_ps(600.0f);
+        while (i + 4 <= count && !_mm_movemask_ps(_mm_cmpgt_ps(_mm_sub_ps(_mm_loadu_ps(y + i), radius), bottom))) i += 4;
     }
-    ballSpeedMultiplier += 0.1f; // Slightly increase the ball speed for the new level
+#else
+    (void)simd;
+#endif
+
+    while (i < count && !(y[i] - ballRadius > 600)) ++i;
+    if (i == count) return 0;
+
+    size_t kept = i;
+    for (; i < count; ++i) {
+        if (y[i] - ballRadius > 600) continue;
+        x[kept] = x[i];
+        y[kept] = y[i];
+        vx[kept] = vx[i];
+        vy[kept] = vy[i];
+        ++kept;
+    }
+    balls.x.resize(kept);
+    balls.y.resize(kept);
+    balls.vx.resize(kept);
+    balls.vy.resize(kept);
+    return count - kept;
 }
 
-// Function to display the "YOU SUCK!" message before the game starts
-void displayYouSuckMessage(sf::RenderWindow& window, const sf::Font& font) {
-    const std::string message = "YOU SUCK!";
-    const float blockSize = 30.0f;
-    const float startX = 250.0f;
-    const float startY = 250.0f;
+// Everything the game simulation needs, free of windows, sounds and shapes
+// so that it can also run headless (see runSelfPlay)
+struct World {
+    int level = Level;
+    int brickRows = ::brickRows;
+    int remainingBalls = maxBalls;
+    int score = 0;
+    float ballSpeedMultiplier = 1.0f;
+    bool gameOver = false;
 
-    std::vector<sf::RectangleShape> blocks;
+    sf::Vector2f paddlePosition = sf::Vector2f(350, 550);
 
-    // Create blocks to spell "YOU SUCK!"
-    for (size_t i = 0; i < message.size(); ++i) {
-        sf::RectangleShape block(sf::Vector2f(blockSize, blockSize));
-        block.setFillColor(sf::Color::White);
-        block.setPosition(startX + i * (blockSize + 10), startY);
-        blocks.push_back(block);
+    BallSet balls;
+
+    // Bricks are deliberately not ECS entities. Their order is game state: the falling
+    // row is the last brickColumns entries, erased in place, and broken bricks are
+    // reported in this order, which sets the order debris draws random numbers. The
+    // registry swap-removes, which would change both and every golden frame with them.
+    std::vector<Brick> bricks; // Container of bricks
+    std::vector<sf::Uint8> fallen; // One bit per layout slot: bricks that dropped out of this level rather than being hit
+
+    World() {
+        // Room for the first levels up front, so steady-state frames never allocate
+        balls.reserve(maxBalls + 8);
+        bricks.reserve(reservedBrickRows * brickColumns);
+        fallen.reserve(reservedBrickRows * brickColumns / 8);
+        balls.push(sf::Vector2f(400, 300), sf::Vector2f(3.0f, -4.0f));
     }
 
-    sf::Text letter;
-    letter.setFont(font);
-    letter.setCharacterSize(20);
-    letter.setFillColor(sf::Color::Black);
+    // Simulation ticks so far, used instead of wall clocks so headless games behave the
+    // same; a count rather than a float time, so days of attract mode never lose ticks
+    long long tick = 0;
+    EventScheduler scheduler; // Level timers such as the falling row
 
-    // Animate blocks falling
-    for (int frame = 0; frame < 100; ++frame) {
-        window.clear();
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            blocks[i].move(0, 1); // Move blocks down
-            window.draw(blocks[i]);
+    // Index of the next brick to drop while the last row is falling
+    size_t currentBrickIndex = 0;
+};
 
-            // Draw letters
-            letter.setString(std::string(1, message[i]));
-            letter.setPosition(blocks[i].getPosition() + sf::Vector2f(5, 5));
-            window.draw(letter);
+// What happened during one simulation frame, so the caller can play sounds and spawn debris
+struct FrameEvents {
+    int paddleHits = 0;
+    int ballsLost = 0;
+    bool levelCleared = false;
+    bool gameOver = false;
+    std::vector<sf::Vector2f> destroyedBricks;
+
+    FrameEvents() {
+        destroyedBricks.reserve(brickColumns);
+    }
+
+    void clear() {
+        paddleHits = 0;
+        ballsLost = 0;
+        levelCleared = false;
+        gameOver = false;
+        destroyedBricks.clear();
+    }
+};
+
+// Function to reset the level with increased difficulty
+void resetLevel(World& world) {
+    world.bricks.clear();
+    world.level++;
+    world.brickRows++;
+    world.remainingBalls++;
+    world.scheduler.clear(); // Drop the previous level's timers
+    world.scheduler.schedule(world.tick + ticksFor(7.0f), TimedEventType::StartRowFall); // Start falling after 7 seconds
+    world.fallen.assign((world.brickRows * brickColumns + 7) / 8, 0);
+
+    for (int row = 0; row < world.brickRows; ++row) {
+        for (int col = 0; col < brickColumns; ++col) {
+            Brick brick;
+            brick.slot = row * brickColumns + col;
+            brick.position = brickHome(brick.slot);
+            brick.colorIndex = row % 5;
+            world.bricks.push_back(brick);
         }
-        window.display();
-        sf::sleep(sf::milliseconds(10));
     }
+    world.ballSpeedMultiplier += 0.1f; // Slightly increase the ball speed for the new level
 }
 
-void displayReadyMessage(sf::RenderWindow& window, const sf::Font& font) {
-    const std::string message = "READY?";
-    const float blockSize = 30.0f;
-    const float startX = 250.0f;
-    const float startY = 250.0f;
-    const float explosionDuration = 60; // Frames for explosion animation
-
-    std::vector<sf::RectangleShape> blocks;
-    std::vector<std::vector<sf::CircleShape>> particles(message.size());
+// Staggered falling for the last row: one brick every half second
+void fireTimedEvent(World& world, const TimedEvent& event) {
+    std::vector<Brick>& bricks = world.bricks;
 
-    // Create blocks to spell "READY?"
-    for (size_t i = 0; i < message.size(); ++i) {
-        sf::RectangleShape block(sf::Vector2f(blockSize, blockSize));
-        block.setFillColor(sf::Color::White);
-        block.setPosition(startX + i * (blockSize + 10), -blockSize); // Start above the screen
-        blocks.push_back(block);
+    switch (event.type) {
+    case TimedEventType::StartRowFall:
+        world.currentBrickIndex = bricks.size() >= brickColumns ? bricks.size() - brickColumns : 0; // First brick in the last row
+        world.scheduler.schedule(event.tick + ticksFor(0.5f), TimedEventType::DropBrick);
+        break;
 
-        // Prepare explosion particles for each block
-        for (int j = 0; j < 30; ++j) { // 30 particles per block
-            sf::CircleShape particle(2); // Small circle for particle effect
-            particle.setFillColor(sf::Color::White);
-            particle.setPosition(block.getPosition() + sf::Vector2f(blockSize / 2, blockSize / 2));
-            particles[i].push_back(particle);
+    case TimedEventType::DropBrick:
+        // Start over from the last row once every brick has had a turn
+        if (world.currentBrickIndex >= bricks.size()) {
+            world.currentBrickIndex = bricks.size() >= brickColumns ? bricks.size() - brickColumns : 0;
+        }
+        if (world.currentBrickIndex < bricks.size()) {
+            bricks[world.currentBrickIndex].position.y += 50; // Move current brick downward (adjust speed as needed)
+
+            // Remove brick if it goes out of bounds, and drop the one that takes its place next frame
+            if (bricks[world.currentBrickIndex].position.y > 600) {
+                int slot = bricks[world.currentBrickIndex].slot;
+                world.fallen[slot / 8] |= static_cast<sf::Uint8>(1 << (slot % 8));
+                bricks.erase(bricks.begin() + world.currentBrickIndex);
+                world.scheduler.schedule(event.tick + 1, TimedEventType::DropBrick);
+                break;
+            }
+            ++world.currentBrickIndex; // Move to the next brick
         }
+        world.scheduler.schedule(event.tick + ticksFor(0.5f), TimedEventType::DropBrick); // Next brick after a delay
+        break;
     }
+}
 
-    sf::Text letter;
-    letter.setFont(font);
-    letter.setCharacterSize(20);
-    letter.setFillColor(sf::Color::Black);
+// Paddle input for one frame, as if the arrow keys were pressed
+struct PaddleInput {
+    bool left = false;
+    bool right = false;
+};
 
-    // Animate blocks falling (entrance)
-    for (int frame = 0; frame < 120; ++frame) {
-        window.clear();
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            if (blocks[i].getPosition().y < startY) {
-                blocks[i].move(0, 3); // Faster fall to simulate gravity
+// Bounce each ball off the bricks it touches, in ball order, destroying them
+void hitBricks(World& world, FrameEvents& events) {
+    std::vector<Brick>& bricks = world.bricks;
+    BallSet& balls = world.balls;
+    for (size_t i = 0; i < balls.size(); ++i) {
+        const float x = balls.x[i], y = balls.y[i];
+        for (auto it = bricks.begin(); it != bricks.end();) {
+            if (x + ballRadius > it->position.x &&
+                x - ballRadius < it->position.x + brickWidth &&
+                y + ballRadius > it->position.y &&
+                y - ballRadius < it->position.y + brickHeight) {
+                balls.vy[i] = -balls.vy[i];
+                events.destroyedBricks.push_back(it->position);
+                it = bricks.erase(it);
+                world.score += 100;
+            }
+            else {
+                ++it;
             }
-            window.draw(blocks[i]);
+        }
+    }
+}
 
-            // Draw letters
-            letter.setString(std::string(1, message[i]));
-            letter.setPosition(blocks[i].getPosition() + sf::Vector2f(5, 5));
-            window.draw(letter);
+// Advance the game by one frame
+void stepWorld(World& world, const PaddleInput& input, FrameEvents& events) {
+    events.clear();
+    if (world.gameOver) return;
+
+    ++world.tick;
+
+    // Paddle movement
+    if (input.left && world.paddlePosition.x > 0) {
+        world.paddlePosition.x -= paddleSpeed;
+    }
+    if (input.right && world.paddlePosition.x + paddleWidth < 800) {
+        world.paddlePosition.x += paddleSpeed;
+    }
+
+    // Move all the balls and bounce them off the walls and paddle as one batch, then
+    // let them hit bricks one by one, then take out the ones that were lost
+    BallSet& balls = world.balls;
+    const sf::Vector2f& paddle = world.paddlePosition;
+    for (;;) {
+        events.paddleHits += moveBalls(balls, world.ballSpeedMultiplier, paddle);
+        hitBricks(world, events);
+        size_t lost = removeLostBalls(balls);
+        events.ballsLost += static_cast<int>(lost);
+        if (lost == 0 || !balls.empty()) break;
+
+        if (world.remainingBalls > 1) {
+            // Serve the next ball from the paddle; it gets this frame's move too
+            --world.remainingBalls;
+            balls.push(sf::Vector2f(paddle.x + paddleWidth / 2, paddle.y - 20), sf::Vector2f(3.0f, -4.0f));
+            continue;
         }
-        window.display();
-        sf::sleep(sf::milliseconds(10));
+        world.gameOver = true;
+        events.gameOver = true;
+        return;
     }
 
-    // Explosion animation
-    for (int frame = 0; frame < explosionDuration; ++frame) {
-        window.clear();
+    // Fire the level timers that came due this frame
+    TimedEvent timedEvent;
+    while (world.scheduler.popDue(world.tick, timedEvent)) {
+        fireTimedEvent(world, timedEvent);
+    }
 
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            // Reduce block opacity for fade effect
-            blocks[i].setFillColor(sf::Color(255, 255, 255, 255 - (frame * 255 / explosionDuration)));
-            window.draw(blocks[i]);
+    // Check if all bricks are cleared
+    if (world.bricks.empty()) {
+        events.levelCleared = true;
+        resetLevel(world);
+    }
+}
 
-            // Animate particles
-            for (auto& particle : particles[i]) {
-                particle.setPosition(400, 300);
-                float angle = static_cast<float>(rand()) / RAND_MAX * 126.28f; // Random angle in radians
-                float speed = static_cast<float>(frame) / explosionDuration * 12.0f; // Increase speed over time
-                particle.move(cos(angle) * speed, sin(angle) * speed);
-                particle.setFillColor(sf::Color(255, 0, 0, 255 - (frame * 255 / explosionDuration)));
-                window.draw(particle);
+// Interface for anything that can steer the paddle
+class PaddleController {
+public:
+    virtual ~PaddleController() {}
+    virtual PaddleInput update(const World& world) = 0;
+};
 
+// Human player on the arrow keys
+class KeyboardController : public PaddleController {
+public:
+    PaddleInput update(const World&) override {
+        PaddleInput input;
+        input.left = sf::Keyboard::isKeyPressed(sf::Keyboard::Left);
+        input.right = sf::Keyboard::isKeyPressed(sf::Keyboard::Right);
+        return input;
+    }
+};
 
+// Computer player: predicts where the next ball will reach the paddle and moves there
+class AiController : public PaddleController {
+public:
+    PaddleInput update(const World& world) override {
+        const float paddleCenter = world.paddlePosition.x + paddleWidth / 2;
+        const float paddleLine = world.paddlePosition.y - ballRadius;
+        float targetX = paddleCenter;
+        float soonest = std::numeric_limits<float>::max();
+        float lowestY = -std::numeric_limits<float>::max();
+
+        for (size_t i = 0; i < world.balls.size(); ++i) {
+            const sf::Vector2f position = world.balls.position(i);
+            const sf::Vector2f velocity = world.balls.velocity(i) * world.ballSpeedMultiplier;
+
+            if (velocity.y > 0) {
+                // Falling ball: follow its path, bouncing off the side walls, down to the paddle
+                float frames = (paddleLine - position.y) / velocity.y;
+                if (frames < soonest) {
+                    soonest = frames;
+                    targetX = foldIntoCourt(position.x + velocity.x * frames);
+                }
+            }
+            else if (soonest == std::numeric_limits<float>::max() && position.y > lowestY) {
+                // Nothing is falling yet: shadow the lowest rising ball
+                lowestY = position.y;
+                targetX = position.x;
             }
         }
-        window.display();
-        sf::sleep(sf::milliseconds(10));
+
+        PaddleInput input;
+        input.left = targetX < paddleCenter - paddleSpeed;
+        input.right = targetX > paddleCenter + paddleSpeed;
+        return input;
     }
-}
 
-// Function to display the "LEVEL DONE!" message before the game starts
-void displayYouWonMessage(sf::RenderWindow& window, const sf::Font& font) {
-    const std::string message = "LEVEL DONE!";
-    const float blockSize = 30.0f;
-    const float startX = 250.0f;
-    const float startY = 250.0f;
+private:
+    // Reflect an unbounded x coordinate off the side walls like the ball would
+    static float foldIntoCourt(float x) {
+        const float span = 800 - 2 * ballRadius;
+        float u = std::fmod(x - ballRadius, 2 * span);
+        if (u < 0) u += 2 * span;
+        if (u > span) u = 2 * span - u;
+        return u + ballRadius;
+    }
+};
 
-    std::vector<sf::RectangleShape> blocks;
 
-    // Create blocks to spell "LEVEL DONE!"
-    for (size_t i = 0; i < message.size(); ++i) {
-        sf::RectangleShape block(sf::Vector2f(blockSize, blockSize));
-        block.setFillColor(sf::Color::White);
-        block.setPosition(startX + i * (blockSize + 10), startY);
-        blocks.push_back(block);
+// Score line that is only reformatted when one of the values changes
+class Hud {
+public:
+    void update(int score, int balls, int level) {
+        if (score == shownScore && balls == shownBalls && level == shownLevel) return;
+        shownScore = score;
+        shownBalls = balls;
+        shownLevel = level;
+
+        std::snprintf(buffer, sizeof(buffer), "Score: %d | Balls: %d | Level: %d", score, balls, level);
+    }
+
+    void draw(RenderBackend& renderer) const {
+        renderer.text(sf::Vector2f(10, 10), buffer, 20, sf::Color::White);
     }
 
-    sf::Text letter;
-    letter.setFont(font);
-    letter.setCharacterSize(20);
-    letter.setFillColor(sf::Color::Black);
+private:
+    char buffer[64] = {};
+    int shownScore = -1;
+    int shownBalls = -1;
+    int shownLevel = -1;
+};
 
-    // Animate blocks falling
-    for (int frame = 0; frame < 120; ++frame) {
-        window.clear();
-        for (size_t i = 0; i < blocks.size(); ++i) {
-            blocks[i].move(0, 1); // Move blocks down
-            window.draw(blocks[i]);
+// Glyph quads for the banner letters, laid out once per character instead of
+// running sf::Text::setString for every block on every frame
+class GlyphCache {
+public:
+    GlyphCache(unsigned characterSize, sf::Color color) : characterSize(characterSize), color(color) {}
 
-            // Draw letters
-            letter.setString(std::string(1, message[i]));
-            letter.setPosition(blocks[i].getPosition() + sf::Vector2f(5, 5));
-            window.draw(letter);
-        }
-        window.display();
-        sf::sleep(sf::milliseconds(10));
+    bool matches(unsigned size, sf::Color c) const {
+        return size == characterSize && c == color;
     }
-}
 
-int main() {
-    sf::RenderWindow window(sf::VideoMode(800, 600), "Breakout Remix");
-    window.setFramerateLimit(60);
+    void draw(sf::RenderWindow& window, const sf::Font& font, char c, sf::Vector2f position) {
+        if (&font != cachedFont) {
+            for (auto& quad : quads) quad.clear();
+            cachedFont = &font;
+        }
 
-    // Paddle properties
-    sf::RectangleShape paddle(sf::Vector2f(200, 20));
-    paddle.setFillColor(sf::Color::Green);
-    paddle.setPosition(350, 550);
+        sf::VertexArray& quad = quads[static_cast<unsigned char>(c)];
+        if (quad.getVertexCount() == 0) {
+            build(font, c, quad);
+        }
 
-    // Ball properties
-    std::vector<sf::CircleShape> balls(1, sf::CircleShape(10));
-    std::vector<sf::Vector2f> ballPositions(1, sf::Vector2f(400, 300));
-    std::vector<sf::Vector2f> ballVelocities(1, sf::Vector2f(3.0f, -4.0f));
-    float ballRadius = 10.0f;
-    float ballSpeedMultiplier = 1.0f;
+        sf::RenderStates states;
+        states.texture = &font.getTexture(characterSize);
+        states.transform.translate(position.x, position.y);
+        window.draw(quad, states);
+    }
 
-    for (auto& ball : balls) {
-        ball.setFillColor(sf::Color::Red);
-        ball.setOrigin(10, 10);
+private:
+    // Two triangles placed the way sf::Text places a glyph on its first line
+    void build(const sf::Font& font, char c, sf::VertexArray& quad) const {
+        const sf::Glyph& glyph = font.getGlyph(static_cast<unsigned char>(c), characterSize, false);
+        float left = glyph.bounds.left;
+        float top = characterSize + glyph.bounds.top;
+        float right = left + glyph.bounds.width;
+        float bottom = top + glyph.bounds.height;
+
+        float u1 = static_cast<float>(glyph.textureRect.left);
+        float v1 = static_cast<float>(glyph.textureRect.top);
+        float u2 = u1 + glyph.textureRect.width;
+        float v2 = v1 + glyph.textureRect.height;
+
+        quad.setPrimitiveType(sf::Triangles);
+        quad.append(sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(u1, v1)));
+        quad.append(sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1)));
+        quad.append(sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2)));
+        quad.append(sf::Vertex(sf::Vector2f(left, bottom), color, sf::Vector2f(u1, v2)));
+        quad.append(sf::Vertex(sf::Vector2f(right, top), color, sf::Vector2f(u2, v1)));
+        quad.append(sf::Vertex(sf::Vector2f(right, bottom), color, sf::Vector2f(u2, v2)));
     }
 
-    // Bricks
-    const int brickColumns = 10;
-    const float brickWidth = 60.0f;
-    const float brickHeight = 20.0f;
-    std::vector<sf::RectangleShape> bricks;
-    sf::Color brickColors[] = { sf::Color::Red, sf::Color::Yellow, sf::Color::Green, sf::Color::Blue, sf::Color::Magenta, sf::Color::White, sf::Color::Red, sf::Color::Black };
+    unsigned characterSize;
+    sf::Color color;
+    const sf::Font* cachedFont = nullptr;
+    sf::VertexArray quads[256];
+};
 
-    resetLevel(bricks, brickRows, brickColumns, brickWidth, brickHeight, brickColors, ballSpeedMultiplier);
+// The game drawn through an SFML window. Shapes are reused for every draw, and text
+// is only re-laid out when a string changes, so steady frames don't allocate.
+class SfmlBackend : public RenderBackend {
+public:
+    SfmlBackend(sf::RenderWindow& window, const sf::Font& font) : window(window), font(font) {
+        for (auto& text : texts) {
+            text.setFont(font);
+        }
+    }
 
-    // Score
-    int score = 0;
-    sf::Font font;
-    if (!font.loadFromFile("C:/Users/abroadbent/source/repos/BMP_Create/font/arial.ttf")) {
-        std::cerr << "Failed to load font!\n";
-        return -1;
+    void clear(sf::Color color) override {
+        window.clear(color);
     }
-    sf::Text scoreText;
-    scoreText.setFont(font);
-    scoreText.setCharacterSize(20);
-    scoreText.setFillColor(sf::Color::White);
-    scoreText.setPosition(10, 10);
 
-    // Sound effects
-    sf::SoundBuffer scoreBuffer, loseBallBuffer, hitBallBuffer, ready3Buffer, winBuffer;
-    if (!scoreBuffer.loadFromFile("C:/Users/abroadbent/source/repos/BMP_Create/wav/score.wav") ||
-        !loseBallBuffer.loadFromFile("C:/Users/abroadbent/source/repos/BMP_Create/wav/lose_ball.wav") ||
-        !hitBallBuffer.loadFromFile("C:/Users/abroadbent/source/repos/BMP_Create/wav/hit_ball.wav") ||
-        !ready3Buffer.loadFromFile("C:/Users/abroadbent/source/repos/BMP_Create/wav/ready3.wav") ||
-        !winBuffer.loadFromFile("C:/Users/abroadbent/source/repos/BMP_Create/wav/win.wav")) {
-        std::cerr << "Failed to load sound effects!\n";
-        return -1;
+    void rect(sf::Vector2f position, sf::Vector2f size, sf::Color color) override {
+        rotatedRect(position, size, 0.0f, color);
     }
-    sf::Sound scoreSound(scoreBuffer);
-    sf::Sound hitBallSound(hitBallBuffer);
-    sf::Sound ready3Sound(ready3Buffer);
-    sf::Sound loseBallSound(loseBallBuffer);
-    sf::Sound winSound(winBuffer);
 
-    // Display "READY?" and sound at the start
-    ready3Sound.play();
-    displayReadyMessage(window, font);
+    void rotatedRect(sf::Vector2f position, sf::Vector2f size, float degrees, sf::Color color) override {
+        rectangle.setSize(size);
+        rectangle.setPosition(position);
+        rectangle.setRotation(degrees);
+        rectangle.setFillColor(color);
+        window.draw(rectangle);
+    }
 
-    // Game loop
-    while (window.isOpen()) {
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed)
-                window.close();
+    void circle(sf::Vector2f center, float radius, sf::Color color) override {
+        if (circleShape.getRadius() != radius) {
+            circleShape.setRadius(radius);
+            circleShape.setOrigin(radius, radius);
         }
+        circleShape.setPosition(center);
+        circleShape.setFillColor(color);
+        window.draw(circleShape);
+    }
 
-        // Paddle movement
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Left) && paddle.getPosition().x > 0) {
-            paddle.move(-7.0f, 0.0f);
+    // Each text drawn in a frame gets its own sf::Text, matched up by draw order
+    void text(sf::Vector2f position, const char* string, unsigned characterSize, sf::Color color) override {
+        if (nextText == textSlots) return;
+        sf::Text& text = texts[nextText];
+        char* shown = shownStrings[nextText];
+        ++nextText;
+
+        if (std::strncmp(shown, string, sizeof(shownStrings[0])) != 0) {
+            std::snprintf(shown, sizeof(shownStrings[0]), "%s", string);
+            text.setString(shown);
         }
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Right) && paddle.getPosition().x + paddle.getSize().x < 800) {
-            paddle.move(7.0f, 0.0f);
+        text.setCharacterSize(characterSize);
+        text.setFillColor(color);
+        text.setPosition(position);
+        window.draw(text);
+    }
+
+    void glyph(char c, sf::Vector2f position, unsigned characterSize, sf::Color color) override {
+        GlyphCache* cache = nullptr;
+        for (auto& candidate : glyphCaches) {
+            if (candidate->matches(characterSize, color)) cache = candidate.get();
         }
+        if (!cache) {
+            glyphCaches.emplace_back(new GlyphCache(characterSize, color));
+            cache = glyphCaches.back().get();
+        }
+        cache->draw(window, font, c, position);
+    }
 
-        // Ball and collision logic
-        for (size_t i = 0; i < balls.size(); ++i) {
-            ballPositions[i] += ballVelocities[i] * ballSpeedMultiplier;
+    void image(const sf::Uint8* rgba, int width, int height, sf::Vector2f position, sf::Vector2f scale, bool changed) override {
+        sf::Vector2u size = texture.getSize();
+        if (size.x != static_cast<unsigned>(width) || size.y != static_cast<unsigned>(height)) {
+            texture.create(width, height);
+            sprite.setTexture(texture, true);
+            changed = true;
+        }
+        if (changed) texture.update(rgba);
+        sprite.setPosition(position);
+        sprite.setScale(scale);
+        window.draw(sprite);
+    }
 
-            // Ball collision with walls
-            if (ballPositions[i].x - ballRadius < 0 || ballPositions[i].x + ballRadius > 800) {
-                ballVelocities[i].x = -ballVelocities[i].x;
-            }
-            if (ballPositions[i].y - ballRadius < 0) {
-                ballVelocities[i].y = -ballVelocities[i].y;
-            }
+    void display() override {
+        window.display();
+        nextText = 0;
+    }
 
-            // Ball collision with paddle
-            if (ballPositions[i].y + ballRadius >= paddle.getPosition().y &&
-                ballPositions[i].x + ballRadius >= paddle.getPosition().x &&
-                ballPositions[i].x - ballRadius <= paddle.getPosition().x + paddle.getSize().x) {
-                ballPositions[i].y = paddle.getPosition().y - ballRadius;
-                ballVelocities[i].y = -std::abs(ballVelocities[i].y);
-                hitBallSound.play();
-            }
+    void hold(int milliseconds) override {
+        sf::sleep(sf::milliseconds(milliseconds));
+    }
 
-            // Ball collision with bricks
-            for (auto it = bricks.begin(); it != bricks.end();) {
-                if (ballPositions[i].x + ballRadius > it->getPosition().x &&
-                    ballPositions[i].x - ballRadius < it->getPosition().x + brickWidth &&
-                    ballPositions[i].y + ballRadius > it->getPosition().y &&
-                    ballPositions[i].y - ballRadius < it->getPosition().y + brickHeight) {
-                    ballVelocities[i].y = -ballVelocities[i].y;
-                    it = bricks.erase(it);
-                    scoreSound.play();
-                    score += 100;
-                    spawnDebris(debris, it->getPosition(), brickHitDebris);
-                }
-                else {
-                    ++it;
-                }
-            }
+private:
+    static const int textSlots = 8;
+
+    sf::RenderWindow& window;
+    const sf::Font& font;
+    sf::RectangleShape rectangle;
+    sf::CircleShape circleShape;
+    sf::Text texts[textSlots];
+    char shownStrings[textSlots][64] = {};
+    int nextText = 0;
+    std::vector<std::unique_ptr<GlyphCache>> glyphCaches;
+    sf::Texture texture;
+    sf::Sprite sprite;
+};
 
-            // Ball out of bounds
-            if (ballPositions[i].y - ballRadius > 600) {
-                balls.erase(balls.begin() + i);
-                ballPositions.erase(ballPositions.begin() + i);
-                ballVelocities.erase(ballVelocities.begin() + i);
-                loseBallSound.play();
-                --i;
-
-                if (balls.empty() && remainingBalls > 1) {
-                    --remainingBalls;
-                    balls.push_back(sf::CircleShape(10));
-                    balls.back().setFillColor(sf::Color::Red);
-                    balls.back().setOrigin(10, 10);
-                    ballPositions.push_back(sf::Vector2f(paddle.getPosition().x + paddle.getSize().x / 2, paddle.getPosition().y - 20));
-                    ballVelocities.push_back(sf::Vector2f(3.0f, -4.0f));
-                }
-                else if (balls.empty()) {
-                    std::cout << "Game Over!" << std::endl;
-                    loseBallSound.play();
-                    displayYouSuckMessage(window, font);
-                    std::chrono::seconds(3);
-                    window.close();
-                }
+// 5x7 bitmap font for printable ASCII, one byte per column, bit 0 at the top
+const sf::Uint8 builtinFont[95][5] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 }, // space ! " #
+    { 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 }, // $ % & '
+    { 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 }, { 0x08, 0x2A, 0x1C, 0x2A, 0x08 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 }, // ( ) * +
+    { 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x60, 0x60, 0x00, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 }, // , - . /
+    { 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 }, // 0 1 2 3
+    { 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 }, // 4 5 6 7
+    { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E }, { 0x00, 0x36, 0x36, 0x00, 0x00 }, { 0x00, 0x56, 0x36, 0x00, 0x00 }, // 8 9 : ;
+    { 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 }, // < = > ?
+    { 0x32, 0x49, 0x79, 0x41, 0x3E }, { 0x7E, 0x11, 0x11, 0x11, 0x7E }, { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 }, // @ A B C
+    { 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, { 0x7F, 0x09, 0x09, 0x09, 0x01 }, { 0x3E, 0x41, 0x49, 0x49, 0x7A }, // D E F G
+    { 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 }, // H I J K
+    { 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x0C, 0x02, 0x7F }, { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E }, // L M N O
+    { 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, { 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x46, 0x49, 0x49, 0x49, 0x31 }, // P Q R S
+    { 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x3F, 0x40, 0x38, 0x40, 0x3F }, // T U V W
+    { 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x07, 0x08, 0x70, 0x08, 0x07 }, { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 }, // X Y Z [
+    { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 }, { 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 }, // \ ] ^ _
+    { 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 }, { 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 }, // ` a b c
+    { 0x38, 0x44, 0x44, 0x48, 0x7F }, { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x0C, 0x52, 0x52, 0x52, 0x3E }, // d e f g
+    { 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, { 0x20, 0x40, 0x44, 0x3D, 0x00 }, { 0x7F, 0x10, 0x28, 0x44, 0x00 }, // h i j k
+    { 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 }, { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 }, // l m n o
+    { 0x7C, 0x14, 0x14, 0x14, 0x08 }, { 0x08, 0x14, 0x14, 0x18, 0x7C }, { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 }, // p q r s
+    { 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, { 0x1C, 0x20, 0x40, 0x20, 0x1C }, { 0x3C, 0x40, 0x30, 0x40, 0x3C }, // t u v w
+    { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C }, { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 }, // x y z {
+    { 0x00, 0x00, 0x7F, 0x00, 0x00 }, { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x08, 0x04, 0x08, 0x10, 0x08 },                                   // | } ~
+};
 
-            }
-            // Start staggered falling for the last row after 7 seconds
-            if (!bricks.empty() && levelClock.getElapsedTime().asSeconds() > 7) {
-                lastRowFalling = true; // Start falling after 7 seconds
-            }
+// The game drawn into an in-memory framebuffer on the CPU. Coverage is decided at
+// pixel centres, so the same scene always gives the same pixels, and spans are
+// filled and blended four pixels at a time with SSE2 where the CPU has it.
+class SoftwareBackend : public RenderBackend {
+public:
+    SoftwareBackend(int width, int height) : width(width), height(height), pixels(static_cast<size_t>(width) * height, 0) {}
 
-            if (lastRowFalling) {
-                // Ensure `currentBrickIndex` starts at the correct position
-                if (currentBrickIndex >= bricks.size()) {
-                    currentBrickIndex = bricks.size() - brickColumns;
-                    if (currentBrickIndex < 0) currentBrickIndex = 0; // Ensure it doesn't go negative
-                }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
 
-                // Drop bricks one by one with a delay
-                if (brickFallClock.getElapsedTime().asSeconds() > 0.5f && currentBrickIndex < bricks.size()) {
-                    bricks[currentBrickIndex].move(0, 50); // Move current brick downward (adjust speed as needed)
+    // RGBA, one 32-bit word per pixel in memory order r, g, b, a
+    const std::vector<sf::Uint32>& getPixels() const { return pixels; }
 
-                    // Remove brick if it goes out of bounds
-                    if (bricks[currentBrickIndex].getPosition().y > 600) {
-                        bricks.erase(bricks.begin() + currentBrickIndex);
-                        continue; // Skip further processing for this brick
-                    }
+    // Switch the SSE2 span code off, to compare against the scalar version
+    void setSimd(bool enabled) { simd = enabled; }
 
-                    ++currentBrickIndex; // Move to the next brick
-                    brickFallClock.restart(); // Reset the clock for the next brick
-                }
-            }
+    // Called by display() after every frame, e.g. to dump or check it
+    void setFrameHandler(std::function<void(const SoftwareBackend&)> handler) { frameHandler = handler; }
+
+    long long getPixelsFilled() const { return pixelsFilled; }
+
+    void clear(sf::Color color) override {
+        sf::Color opaque(color.r, color.g, color.b, 255);
+        for (int y = 0; y < height; ++y) {
+            span(y, 0, width, opaque);
         }
+    }
 
-        // Check if all bricks are cleared
-        if (bricks.empty()) {
-            winSound.play();
-            displayYouWonMessage(window, font);
+    // A pixel is covered when its centre is, so touching shapes never overlap or leave gaps
+    void rect(sf::Vector2f position, sf::Vector2f size, sf::Color color) override {
+        int x0 = pixelStart(position.x), x1 = pixelStart(position.x + size.x);
+        int y0 = pixelStart(position.y), y1 = pixelStart(position.y + size.y);
+        for (int y = y0; y < y1; ++y) {
+            span(y, x0, x1, color);
+        }
+    }
 
-            resetLevel(bricks, brickRows, brickColumns, brickWidth, brickHeight, brickColors, ballSpeedMultiplier);
+    void rotatedRect(sf::Vector2f position, sf::Vector2f size, float degrees, sf::Color color) override {
+        if (degrees == 0.0f) {
+            rect(position, size, color);
+            return;
+        }
+        float radians = degrees * 3.14159265f / 180.0f;
+        float c = std::cos(radians), s = std::sin(radians);
+        sf::Vector2f corners[4] = {
+            position,
+            position + sf::Vector2f(size.x * c, size.x * s),
+            position + sf::Vector2f(size.x * c - size.y * s, size.x * s + size.y * c),
+            position + sf::Vector2f(-size.y * s, size.y * c),
+        };
+
+        float top = corners[0].y, bottom = corners[0].y;
+        for (const auto& corner : corners) {
+            top = std::min(top, corner.y);
+            bottom = std::max(bottom, corner.y);
         }
 
-        // Update debris before rendering
-        sf::Time dt = debrisClock.restart();
-        float deltaTime = dt.asSeconds();
-        updateDebris(debris, deltaTime);
+        // Convex, so each row is one span between the leftmost and rightmost edge crossings
+        for (int y = pixelStart(top); y < pixelStart(bottom); ++y) {
+            float centerY = y + 0.5f;
+            float left = std::numeric_limits<float>::max(), right = -left;
+            for (int edge = 0; edge < 4; ++edge) {
+                const sf::Vector2f& a = corners[edge];
+                const sf::Vector2f& b = corners[(edge + 1) % 4];
+                if ((a.y <= centerY) == (b.y <= centerY)) continue;
+                float x = a.x + (centerY - a.y) * (b.x - a.x) / (b.y - a.y);
+                left = std::min(left, x);
+                right = std::max(right, x);
+            }
+            if (left < right) span(y, pixelStart(left), pixelStart(right), color);
+        }
+    }
 
-        // Update ball positions
-        for (size_t i = 0; i < balls.size(); ++i) {
-            balls[i].setPosition(ballPositions[i]);
+    void circle(sf::Vector2f center, float radius, sf::Color color) override {
+        for (int y = pixelStart(center.y - radius); y < pixelStart(center.y + radius); ++y) {
+            float dy = y + 0.5f - center.y;
+            float half = std::sqrt(std::max(0.0f, radius * radius - dy * dy));
+            span(y, pixelStart(center.x - half), pixelStart(center.x + half), color);
         }
+    }
 
-        // Update score display
-        scoreText.setString("Score: " + std::to_string(score) + " | Balls: " + std::to_string(remainingBalls) + " | Level: " + std::to_string(currentLevel));
+    // Built-in font: each font pixel becomes a square a tenth of the character size across
+    void text(sf::Vector2f position, const char* string, unsigned characterSize, sf::Color color) override {
+        float advance = 6.0f * fontPixel(characterSize);
+        for (; *string; ++string) {
+            glyph(*string, position, characterSize, color);
+            position.x += advance;
+        }
+    }
 
-        // Render
-        window.clear();
-        window.draw(paddle);
-        for (const auto& brick : bricks) {
-            window.draw(brick);
+    void glyph(char c, sf::Vector2f position, unsigned characterSize, sf::Color color) override {
+        if (c < 32 || c > 126) return;
+        const sf::Uint8* columns = builtinFont[c - 32];
+        float size = fontPixel(characterSize);
+        position.y += 2.0f * size; // Leave room above, the way SFML places capitals
+        for (int column = 0; column < 5; ++column) {
+            for (int row = 0; row < 7; ++row) {
+                if (columns[column] & (1 << row)) {
+                    rect(position + sf::Vector2f(column * size, row * size), sf::Vector2f(size, size), color);
+                }
+            }
         }
-        for (const auto& ball : balls) {
-            window.draw(ball);
+    }
+
+    // Nearest-neighbour scaling: each source pixel is a span of the rows it covers
+    void image(const sf::Uint8* rgba, int imageWidth, int imageHeight, sf::Vector2f position, sf::Vector2f scale, bool) override {
+        for (int sourceY = 0; sourceY < imageHeight; ++sourceY) {
+            int y0 = pixelStart(position.y + sourceY * scale.y), y1 = pixelStart(position.y + (sourceY + 1) * scale.y);
+            for (int y = y0; y < y1; ++y) {
+                const sf::Uint8* source = rgba + static_cast<size_t>(sourceY) * imageWidth * 4;
+                for (int sourceX = 0; sourceX < imageWidth; ++sourceX, source += 4) {
+                    span(y, pixelStart(position.x + sourceX * scale.x), pixelStart(position.x + (sourceX + 1) * scale.x),
+                         sf::Color(source[0], source[1], source[2], source[3]));
+                }
+            }
         }
-        renderDebris(window, debris);
-        window.draw(scoreText);
-        window.display();
+    }
+
+    void display() override {
+        if (frameHandler) frameHandler(*this);
+        ++frames;
+    }
+
+    void hold(int) override {}
+
+    long long getFrames() const { return frames; }
+
+    // Write the framebuffer as a 24-bit BMP
+    bool save(const std::string& path) const {
+        std::vector<std::uint8_t> bgr(pixels.size() * 3);
+        toBgr(bgr.data());
+        return saveBmp(path, width, height, bgr.data());
+    }
+
+    void toBgr(std::uint8_t* bgr) const {
+        for (size_t i = 0; i < pixels.size(); ++i) {
+            sf::Uint32 pixel = pixels[i];
+            bgr[i * 3] = static_cast<std::uint8_t>(pixel >> 16);
+            bgr[i * 3 + 1] = static_cast<std::uint8_t>(pixel >> 8);
+            bgr[i * 3 + 2] = static_cast<std::uint8_t>(pixel);
+        }
+    }
+
+private:
+    // First pixel whose centre is at or past coordinate v
+    static int pixelStart(float v) {
+        return static_cast<int>(std::ceil(v - 0.5f));
+    }
+
+    static float fontPixel(unsigned characterSize) {
+        return std::max(1.0f, std::floor(characterSize / 10.0f));
+    }
+
+    static sf::Uint32 pack(sf::Color color) {
+        return static_cast<sf::Uint32>(color.r) | static_cast<sf::Uint32>(color.g) << 8 | static_cast<sf::Uint32>(color.b) << 16 | 0xff000000u;
+    }
+
+    // src * a + dst * (255 - a), divided by 255 with exact rounding; SIMD and scalar agree bit for bit
+    static sf::Uint32 blendChannel(sf::Uint32 source, sf::Uint32 destination, sf::Uint32 alpha) {
+        sf::Uint32 t = source * alpha + destination * (255 - alpha) + 128;
+        return (t + (t >> 8)) >> 8;
+    }
+
+    // Fill or blend pixels [x0, x1) of row y, clipped to the framebuffer
+    void span(int y, int x0, int x1, sf::Color color) {
+        if (y < 0 || y >= height || color.a == 0) return;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, width);
+        if (x0 >= x1) return;
+        pixelsFilled += x1 - x0;
+
+        sf::Uint32* row = &pixels[static_cast<size_t>(y) * width];
+        const sf::Uint32 packed = pack(color);
+        int x = x0;
+#if RASTER_SSE2
+        if (simd) {
+            const __m128i value = _mm_set1_epi32(static_cast<int>(packed));
+            if (color.a == 255) {
+                for (; x + 4 <= x1; x += 4) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), value);
+                }
+            }
+            else {
+                // Channels widened to 16 bits: two pixels per half register
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i source = _mm_mullo_epi16(_mm_unpacklo_epi8(value, zero), _mm_set1_epi16(color.a));
+                const __m128i inverse = _mm_set1_epi16(static_cast<short>(255 - color.a));
+                const __m128i rounding = _mm_set1_epi16(128);
+                const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xff000000u));
+                for (; x + 4 <= x1; x += 4) {
+                    __m128i destination = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+                    __m128i low = _mm_add_epi16(_mm_add_epi16(source, _mm_mullo_epi16(_mm_unpacklo_epi8(destination, zero), inverse)), rounding);
+                    __m128i high = _mm_add_epi16(_mm_add_epi16(source, _mm_mullo_epi16(_mm_unpackhi_epi8(destination, zero), inverse)), rounding);
+                    low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+                    high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), _mm_or_si128(_mm_packus_epi16(low, high), opaque));
+                }
+            }
+        }
+#endif
+        if (color.a == 255) {
+            std::fill(row + x, row + x1, packed);
+            return;
+        }
+        for (; x < x1; ++x) {
+            sf::Uint32 destination = row[x];
+            sf::Uint32 r = blendChannel(color.r, destination & 0xff, color.a);
+            sf::Uint32 g = blendChannel(color.g, (destination >> 8) & 0xff, color.a);
+            sf::Uint32 b = blendChannel(color.b, (destination >> 16) & 0xff, color.a);
+            row[x] = r | g << 8 | b << 16 | 0xff000000u;
+        }
+    }
+
+    int width, height;
+    std::vector<sf::Uint32> pixels;
+    bool simd = RASTER_SSE2 != 0;
+    std::function<void(const SoftwareBackend&)> frameHandler;
+    long long frames = 0;
+    long long pixelsFilled = 0;
+};
+
+// Function to display the "YOU SUCK!" message before the game starts
+void displayYouSuckMessage(RenderBackend& renderer) {
+    const std::string message = "YOU SUCK!";
+    const float blockSize = 30.0f;
+    const float startX = 250.0f;
+    const float startY = 250.0f;
+
+    FrameArena::Scope scope(scratch);
+    sf::Vector2f* blocks = scratch.allocate<sf::Vector2f>(message.size());
+
+    // Create blocks to spell "YOU SUCK!"
+    for (size_t i = 0; i < message.size(); ++i) {
+        blocks[i] = sf::Vector2f(startX + i * (blockSize + 10), startY);
+    }
+
+    // Animate blocks falling
+    for (int frame = 0; frame < 100; ++frame) {
+        renderer.clear(sf::Color::Black);
+        for (size_t i = 0; i < message.size(); ++i) {
+            blocks[i].y += 1; // Move blocks down
+            renderer.rect(blocks[i], sf::Vector2f(blockSize, blockSize), sf::Color::White);
+
+            // Draw letters
+            renderer.glyph(message[i], blocks[i] + sf::Vector2f(5, 5), 20, sf::Color::Black);
+        }
+        renderer.display();
+        renderer.hold(10);
+    }
+}
+
+void displayReadyMessage(RenderBackend& renderer) {
+    const std::string message = "READY?";
+    const float blockSize = 30.0f;
+    const float startX = 250.0f;
+    const float startY = 250.0f;
+    const float explosionDuration = 60; // Frames for explosion animation
+
+    FrameArena::Scope scope(scratch);
+    sf::Vector2f* blocks = scratch.allocate<sf::Vector2f>(message.size());
+    const float particleRadius = 2.0f;
+    const int particlesPerBlock = 30;
+
+    // Create blocks to spell "READY?"
+    for (size_t i = 0; i < message.size(); ++i) {
+        blocks[i] = sf::Vector2f(startX + i * (blockSize + 10), -blockSize); // Start above the screen
+    }
+
+    // Animate blocks falling (entrance)
+    for (int frame = 0; frame < 120; ++frame) {
+        renderer.clear(sf::Color::Black);
+        for (size_t i = 0; i < message.size(); ++i) {
+            if (blocks[i].y < startY) {
+                blocks[i].y += 3; // Faster fall to simulate gravity
+            }
+            renderer.rect(blocks[i], sf::Vector2f(blockSize, blockSize), sf::Color::White);
+
+            // Draw letters
+            renderer.glyph(message[i], blocks[i] + sf::Vector2f(5, 5), 20, sf::Color::Black);
+        }
+        renderer.display();
+        renderer.hold(10);
+    }
+
+    // Explosion animation
+    for (int frame = 0; frame < explosionDuration; ++frame) {
+        renderer.clear(sf::Color::Black);
+
+        for (size_t i = 0; i < message.size(); ++i) {
+            // Reduce block opacity for fade effect
+            sf::Uint8 fade = static_cast<sf::Uint8>(255 - (frame * 255 / explosionDuration));
+            renderer.rect(blocks[i], sf::Vector2f(blockSize, blockSize), sf::Color(255, 255, 255, fade));
+
+            // Animate particles
+            for (int j = 0; j < particlesPerBlock; ++j) {
+                float angle = static_cast<float>(rand()) / RAND_MAX * 126.28f; // Random angle in radians
+                float speed = static_cast<float>(frame) / explosionDuration * 12.0f; // Increase speed over time
+                sf::Vector2f position(400 + cos(angle) * speed, 300 + sin(angle) * speed);
+                renderer.circle(position + sf::Vector2f(particleRadius, particleRadius), particleRadius, sf::Color(255, 0, 0, fade));
+
+
+            }
+        }
+        renderer.display();
+        renderer.hold(10);
+    }
+}
+
+// Function to display the "LEVEL DONE!" message before the game starts
+void displayYouWonMessage(RenderBackend& renderer) {
+    const std::string message = "LEVEL DONE!";
+    const float blockSize = 30.0f;
+    const float startX = 250.0f;
+    const float startY = 250.0f;
+
+    FrameArena::Scope scope(scratch);
+    sf::Vector2f* blocks = scratch.allocate<sf::Vector2f>(message.size());
+
+    // Create blocks to spell "LEVEL DONE!"
+    for (size_t i = 0; i < message.size(); ++i) {
+        blocks[i] = sf::Vector2f(startX + i * (blockSize + 10), startY);
+    }
+
+    // Animate blocks falling
+    for (int frame = 0; frame < 120; ++frame) {
+        renderer.clear(sf::Color::Black);
+        for (size_t i = 0; i < message.size(); ++i) {
+            blocks[i].y += 1; // Move blocks down
+            renderer.rect(blocks[i], sf::Vector2f(blockSize, blockSize), sf::Color::White);
+
+            // Draw letters
+            renderer.glyph(message[i], blocks[i] + sf::Vector2f(5, 5), 20, sf::Color::Black);
+        }
+        renderer.display();
+        renderer.hold(10);
+    }
+}
+
+
+// Result of one headless game
+struct SelfPlayResult {
+    int score = 0;
+    int level = 0;
+    long long frames = 0;
+};
+
+// Play one game with the AI until it is lost or the frame cap is reached.
+// The seed varies the serve so that games do not all play out identically.
+SelfPlayResult playHeadlessGame(unsigned seed, long long maxFrames) {
+    World world;
+    AiController ai;
+    FrameEvents events;
+    resetLevel(world);
+
+    std::mt19937 rng(seed);
+    world.balls.x[0] = 200.0f + rng() % 400;
+    world.balls.vx[0] = (rng() % 2 ? 1.0f : -1.0f) * (2.0f + (rng() % 200) / 100.0f);
+
+    SelfPlayResult result;
+    while (!world.gameOver && result.frames < maxFrames) {
+        stepWorld(world, ai.update(world), events);
+        ++result.frames;
+    }
+    result.score = world.score;
+    result.level = world.level;
+    return result;
+}
+
+// Play many independent headless games across threads and report throughput and scores
+void runSelfPlay(int games, int threads, long long maxFrames) {
+    if (games < 1) games = 1;
+    if (threads < 1) threads = 1;
+
+    std::vector<SelfPlayResult> results(games);
+    std::atomic<int> nextGame(0);
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&]() {
+            for (int game = nextGame++; game < games; game = nextGame++) {
+                results[game] = playHeadlessGame(static_cast<unsigned>(game), maxFrames);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long long totalFrames = 0;
+    double totalLevels = 0;
+    std::vector<int> scores;
+    for (const auto& result : results) {
+        totalFrames += result.frames;
+        totalLevels += result.level;
+        scores.push_back(result.score);
+    }
+    std::sort(scores.begin(), scores.end());
+    double meanScore = 0;
+    for (int score : scores) meanScore += score;
+    meanScore /= games;
+
+    std::cout << "Self-play: " << games << " games on " << threads << " threads in " << seconds << " s\n";
+    std::cout << "  games/sec:  " << games / seconds << "\n";
+    std::cout << "  frames/sec: " << totalFrames / seconds << "\n";
+    std::cout << "  mean level: " << totalLevels / games << "\n";
+    std::cout << "  score min " << scores.front() << " | p50 " << scores[games / 2] << " | p90 " << scores[games * 9 / 10]
+              << " | max " << scores.back() << " | mean " << meanScore << "\n";
+
+    // Score distribution in ten equal buckets
+    const int buckets = 10;
+    int bucketSize = std::max(1, (scores.back() - scores.front()) / buckets + 1);
+    std::vector<int> histogram(buckets, 0);
+    for (int score : scores) {
+        histogram[std::min(buckets - 1, (score - scores.front()) / bucketSize)]++;
+    }
+    for (int b = 0; b < buckets; ++b) {
+        int low = scores.front() + b * bucketSize;
+        std::cout << "  " << low << "-" << low + bucketSize - 1 << ": " << std::string(histogram[b] * 50 / games, '#')
+                  << " " << histogram[b] << "\n";
+    }
+}
+
+// Lock-free triple buffer: the writer always has a free slot to fill and the
+// reader always gets the newest complete one, and neither ever waits
+template <typename T>
+class TripleBuffer {
+public:
+    T& writeSlot() {
+        return slots[back];
+    }
+
+    // Hand the filled write slot to the reader
+    void publish() {
+        back = middle.exchange(back | freshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Swap in the newest published slot; returns false if nothing new arrived
+    bool update() {
+        if (!(middle.load(std::memory_order_acquire) & freshBit)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+
+    const T& readSlot() const {
+        return slots[front];
+    }
+
+    // Give every slot the same value, e.g. to size buffers before any thread uses them
+    void reset(const T& value) {
+        for (T& slot : slots) slot = value;
+    }
+
+private:
+    static const int freshBit = 4;
+    static const int indexMask = 3;
+
+    T slots[3];
+    int back = 0;
+    std::atomic<int> middle{ 1 };
+    int front = 2;
+};
+
+const int recentBrickSlots = 64;
+
+// What the renderer needs from one simulation tick
+struct GameSnapshot {
+    std::chrono::steady_clock::time_point published;
+    sf::Vector2f paddlePosition;
+    std::vector<sf::Vector2f> ballPositions;
+    std::vector<Brick> bricks;
+    int score = 0;
+    int remainingBalls = 0;
+    int level = 0;
+
+    // Running totals, so the renderer never misses a sound or a banner when it skips snapshots
+    long long paddleHits = 0;
+    long long ballsLost = 0;
+    long long bricksDestroyed = 0;
+    long long levelsCleared = 0;
+    bool gameOver = false;
+    sf::Vector2f recentBricks[recentBrickSlots]; // Destroyed brick positions, indexed by count % recentBrickSlots
+
+    // When the newest input this tick used was pressed, for input-to-screen latency
+    long long inputChangedNs = 0;
+    GameSnapshot() {
+        // Same head room as World, so copying snapshots around never allocates
+        ballPositions.reserve(maxBalls + 8);
+        bricks.reserve(reservedBrickRows * brickColumns);
+    }
+};
+
+long long steadyNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Add one frame's events to the running totals
+void accumulateEvents(GameSnapshot& totals, const FrameEvents& events) {
+    totals.paddleHits += events.paddleHits;
+    totals.ballsLost += events.ballsLost;
+    for (const auto& position : events.destroyedBricks) {
+        totals.recentBricks[totals.bricksDestroyed++ % recentBrickSlots] = position;
+    }
+    if (events.levelCleared) ++totals.levelsCleared;
+    totals.gameOver = events.gameOver;
+}
+
+// Copy the world into a snapshot slot. The slot's vectors keep their capacity
+// between ticks, so this does not allocate once the game is running.
+void fillSnapshot(GameSnapshot& snapshot, const GameSnapshot& totals, const World& world, long long inputChangedNs) {
+    snapshot.published = std::chrono::steady_clock::now();
+    snapshot.paddlePosition = world.paddlePosition;
+    snapshot.ballPositions.clear();
+    for (size_t i = 0; i < world.balls.size(); ++i) snapshot.ballPositions.push_back(world.balls.position(i));
+    snapshot.bricks.assign(world.bricks.begin(), world.bricks.end());
+    snapshot.score = world.score;
+    snapshot.remainingBalls = world.remainingBalls;
+    snapshot.level = world.level;
+
+    snapshot.paddleHits = totals.paddleHits;
+    snapshot.ballsLost = totals.ballsLost;
+    snapshot.bricksDestroyed = totals.bricksDestroyed;
+    snapshot.levelsCleared = totals.levelsCleared;
+    snapshot.gameOver = totals.gameOver;
+    std::copy(totals.recentBricks, totals.recentBricks + recentBrickSlots, snapshot.recentBricks);
+    snapshot.inputChangedNs = inputChangedNs;
+}
+
+// Spectator streaming: a server sends the game to any number of viewers over TCP.
+// Each update carries only what changed since the update that viewer last got: a
+// bitset of the bricks destroyed since then, split into those hit (which explode) and
+// those that dropped off the bottom (which don't), the bricks that have fallen out of
+// their row, and the score when it moves. Paddle and balls go in every update, positions in
+// 1/8 pixels and velocities in 1/256 pixels per frame.
+//
+// One update is one sf::Packet:
+//   Uint8 flags, Uint16 tick (low bits)
+//   Keyframe:  Uint32 tick, Uint16 level, Uint16 brick rows, bitset of live bricks
+//   Destroyed: bitset of bricks hit since the last update
+//   Fallen:    bitset of bricks that dropped off the bottom since the last update
+//   Moved:     Uint16 count, then Uint16 slot and Int16 y of every brick off its home row
+//   Score:     Int32 score, Uint8 balls left
+//   Int16 paddle x, Uint8 ball count, then Int16 x, y, vx, vy for each ball
+const sf::Uint8 spectatorKeyframe = 1;
+const sf::Uint8 spectatorDestroyed = 2;
+const sf::Uint8 spectatorMoved = 4;
+const sf::Uint8 spectatorScore = 8;
+const sf::Uint8 spectatorGameOver = 16;
+const sf::Uint8 spectatorFallen = 32;
+const float spectatorPositionScale = 8.0f;
+const float spectatorVelocityScale = 256.0f;
+
+sf::Int16 quantise(float value, float scale) {
+    float scaled = std::round(value * scale);
+    return static_cast<sf::Int16>(std::min(32767.0f, std::max(-32768.0f, scaled)));
+}
+
+// A brick that has dropped out of its row: layout slot and current height
+struct MovedBrick {
+    sf::Uint16 slot;
+    sf::Int16 y;
+
+    bool operator==(const MovedBrick& other) const {
+        return slot == other.slot && y == other.y;
+    }
+};
+
+// The part of the world spectators see, as of one simulation tick
+struct SpectatorState {
+    sf::Uint32 tick = 0; // World::tick, which counts exactly; wraps after two years of one game
+    int level = 0;
+    int brickRows = 0;
+    int score = 0;
+    int remainingBalls = 0;
+    bool gameOver = false;
+    sf::Vector2f paddlePosition;
+    std::vector<sf::Vector2f> ballPositions;
+    std::vector<sf::Vector2f> ballVelocities; // Per frame, with the level's speed multiplier applied
+    std::vector<sf::Uint8> alive;             // One bit per layout slot
+    std::vector<sf::Uint8> fallen;            // Same layout: gone this level without being hit
+    std::vector<MovedBrick> moved;
+
+    SpectatorState() {
+        // Same head room as World, so the simulation thread never allocates to publish
+        ballPositions.reserve(maxBalls + 8);
+        ballVelocities.reserve(maxBalls + 8);
+        alive.reserve(reservedBrickRows * brickColumns / 8);
+        fallen.reserve(reservedBrickRows * brickColumns / 8);
+        moved.reserve(reservedBrickRows * brickColumns);
+    }
+};
+
+// Tick order that survives the 32-bit wire tick wrapping around
+bool tickBefore(sf::Uint32 a, sf::Uint32 b) {
+    return static_cast<sf::Int32>(a - b) < 0;
+}
+
+void fillSpectatorState(SpectatorState& state, const World& world) {
+    state.tick = static_cast<sf::Uint32>(world.tick);
+    state.level = world.level;
+    state.brickRows = world.brickRows;
+    state.score = world.score;
+    state.remainingBalls = world.remainingBalls;
+    state.gameOver = world.gameOver;
+    state.paddlePosition = world.paddlePosition;
+    state.ballPositions.clear();
+    state.ballVelocities.clear();
+    for (size_t i = 0; i < world.balls.size(); ++i) {
+        state.ballPositions.push_back(world.balls.position(i));
+        state.ballVelocities.push_back(world.balls.velocity(i) * world.ballSpeedMultiplier);
+    }
+
+    state.alive.assign((world.brickRows * brickColumns + 7) / 8, 0);
+    state.fallen.assign(state.alive.size(), 0);
+    for (size_t i = 0; i < state.fallen.size() && i < world.fallen.size(); ++i) state.fallen[i] = world.fallen[i];
+    state.moved.clear();
+    for (const Brick& brick : world.bricks) {
+        state.alive[brick.slot / 8] |= static_cast<sf::Uint8>(1 << (brick.slot % 8));
+        if (brick.position.y != brickHome(brick.slot).y) {
+            MovedBrick moved = { static_cast<sf::Uint16>(brick.slot), static_cast<sf::Int16>(brick.position.y) };
+            state.moved.push_back(moved);
+        }
+    }
+}
+
+// What one viewer has been sent so far; its next update is a delta from this
+struct SpectatorBaseline {
+    bool valid = false;
+    sf::Uint32 tick = 0;
+    int level = 0;
+    int score = 0;
+    int remainingBalls = 0;
+    std::vector<sf::Uint8> alive;
+    std::vector<MovedBrick> moved;
+};
+
+// Write the update that brings a viewer from `sent` up to `state`, and record it as sent
+void encodeSpectatorUpdate(sf::Packet& packet, const SpectatorState& state, SpectatorBaseline& sent) {
+    // A new level or a new game starts the viewer over from a full brick set
+    bool keyframe = !sent.valid || state.level != sent.level || tickBefore(state.tick, sent.tick) || state.alive.size() != sent.alive.size();
+
+    sf::Uint8 flags = 0;
+    if (keyframe) {
+        flags = spectatorKeyframe | spectatorScore | (state.moved.empty() ? 0 : spectatorMoved);
+    }
+    else {
+        for (size_t i = 0; i < state.alive.size(); ++i) {
+            sf::Uint8 gone = static_cast<sf::Uint8>(sent.alive[i] & ~state.alive[i]);
+            if (gone & ~state.fallen[i]) flags |= spectatorDestroyed;
+            if (gone & state.fallen[i]) flags |= spectatorFallen;
+        }
+        if (state.moved != sent.moved) flags |= spectatorMoved;
+        if (state.score != sent.score || state.remainingBalls != sent.remainingBalls) flags |= spectatorScore;
+    }
+    if (state.gameOver) flags |= spectatorGameOver;
+
+    packet << flags << static_cast<sf::Uint16>(state.tick);
+    if (flags & spectatorKeyframe) {
+        packet << state.tick << static_cast<sf::Uint16>(state.level) << static_cast<sf::Uint16>(state.brickRows);
+        for (sf::Uint8 bits : state.alive) packet << bits;
+    }
+    if (flags & spectatorDestroyed) {
+        for (size_t i = 0; i < state.alive.size(); ++i) {
+            packet << static_cast<sf::Uint8>(sent.alive[i] & ~state.alive[i] & ~state.fallen[i]);
+        }
+    }
+    if (flags & spectatorFallen) {
+        for (size_t i = 0; i < state.alive.size(); ++i) {
+            packet << static_cast<sf::Uint8>(sent.alive[i] & ~state.alive[i] & state.fallen[i]);
+        }
+    }
+    if (flags & spectatorMoved) {
+        packet << static_cast<sf::Uint16>(state.moved.size());
+        for (const MovedBrick& brick : state.moved) packet << brick.slot << brick.y;
+    }
+    if (flags & spectatorScore) {
+        packet << static_cast<sf::Int32>(state.score) << static_cast<sf::Uint8>(std::min(255, state.remainingBalls));
+    }
+
+    packet << quantise(state.paddlePosition.x, spectatorPositionScale);
+    size_t balls = std::min<size_t>(255, state.ballPositions.size());
+    packet << static_cast<sf::Uint8>(balls);
+    for (size_t i = 0; i < balls; ++i) {
+        packet << quantise(state.ballPositions[i].x, spectatorPositionScale) << quantise(state.ballPositions[i].y, spectatorPositionScale)
+               << quantise(state.ballVelocities[i].x, spectatorVelocityScale) << quantise(state.ballVelocities[i].y, spectatorVelocityScale);
+    }
+
+    sent.valid = true;
+    sent.tick = state.tick;
+    sent.level = state.level;
+    sent.score = state.score;
+    sent.remainingBalls = state.remainingBalls;
+    sent.alive = state.alive;
+    sent.moved = state.moved;
+}
+
+// One connected viewer as the server sees it
+struct Spectator {
+    sf::TcpSocket socket;
+    sf::Packet packet;    // The update being sent
+    bool sending = false; // The socket took only part of `packet` so far
+    SpectatorBaseline sent;
+    int id = 0;
+    long long bytes = 0;
+    long long bytesThisReport = 0;
+    std::chrono::steady_clock::time_point joined;
+};
+
+// Streams the world to viewers from its own thread. The simulation hands over its
+// newest state through a triple buffer, so a slow network never holds up a tick.
+class SpectatorServer {
+public:
+    explicit SpectatorServer(unsigned short port) : port(port) {}
+
+    ~SpectatorServer() {
+        stop();
+    }
+
+    bool start() {
+        if (listener.listen(port) != sf::Socket::Done) {
+            std::cerr << "Can't listen for spectators on port " << port << "\n";
+            return false;
+        }
+        running = true;
+        thread = std::thread(&SpectatorServer::run, this);
+        std::cout << "Streaming to spectators on port " << port << "\n";
+        return true;
+    }
+
+    void stop() {
+        running = false;
+        if (thread.joinable()) thread.join();
+        listener.close();
+    }
+
+    // Called by the simulation thread after each batch of ticks; never blocks
+    void publish(const World& world) {
+        fillSpectatorState(states.writeSlot(), world);
+        states.publish();
+    }
+
+private:
+    static const long long reportEveryNs = 5000000000LL;
+
+    void run() {
+        // Only the listener goes in the selector: a selector is limited to 64 sockets
+        // on Windows, and viewers never send anything except when they hang up
+        sf::SocketSelector selector;
+        selector.add(listener);
+        std::vector<std::unique_ptr<Spectator>> spectators;
+        int nextId = 1;
+        long long lastReport = steadyNanoseconds();
+        long long lastHangUpCheck = lastReport;
+
+        while (running) {
+            if (selector.wait(sf::milliseconds(2)) && selector.isReady(listener)) {
+                std::unique_ptr<Spectator> spectator(new Spectator);
+                spectator->socket.setBlocking(false);
+                if (listener.accept(spectator->socket) == sf::Socket::Done) {
+                    spectator->id = nextId++;
+                    spectator->joined = std::chrono::steady_clock::now();
+                    spectators.push_back(std::move(spectator));
+                    std::cout << "Spectator " << spectators.back()->id << " joined, " << spectators.size() << " watching\n";
+                }
+            }
+
+            const SpectatorState* state = states.update() ? &states.readSlot() : nullptr;
+            long long now = steadyNanoseconds();
+            bool checkHangUps = now - lastHangUpCheck > 1000000000LL;
+            if (checkHangUps) lastHangUpCheck = now;
+
+            for (size_t i = 0; i < spectators.size();) {
+                Spectator& spectator = *spectators[i];
+                bool connected = send(spectator, state);
+                if (connected && checkHangUps) {
+                    char scratch[64];
+                    std::size_t received = 0;
+                    sf::Socket::Status status = spectator.socket.receive(scratch, sizeof(scratch), received);
+                    connected = status == sf::Socket::Done || status == sf::Socket::NotReady;
+                }
+                if (!connected) {
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - spectator.joined).count();
+                    std::cout << "Spectator " << spectator.id << " left after " << seconds << " s, " << spectator.bytes << " bytes ("
+                              << spectator.bytes / std::max(seconds, 1e-3) << " bytes/s)\n";
+                    spectators.erase(spectators.begin() + static_cast<std::ptrdiff_t>(i));
+                    continue;
+                }
+                ++i;
+            }
+
+            if (now - lastReport >= reportEveryNs && !spectators.empty()) {
+                report(spectators, (now - lastReport) / 1e9);
+                lastReport = now;
+            }
+        }
+    }
+
+    // Finish a viewer's last update before starting the next one, so a slow link gets
+    // fewer updates instead of a growing queue; the deltas are against what it really has
+    static bool send(Spectator& spectator, const SpectatorState* state) {
+        if (!spectator.sending) {
+            if (!state || (spectator.sent.valid && state->tick == spectator.sent.tick)) return true;
+            spectator.packet.clear();
+            encodeSpectatorUpdate(spectator.packet, *state, spectator.sent);
+            spectator.sending = true;
+        }
+        sf::Socket::Status status = spectator.socket.send(spectator.packet);
+        if (status == sf::Socket::Done) {
+            long long bytes = static_cast<long long>(spectator.packet.getDataSize()) + 4; // Packets go out with a 4-byte size
+            spectator.bytes += bytes;
+            spectator.bytesThisReport += bytes;
+            spectator.sending = false;
+        }
+        return status == sf::Socket::Done || status == sf::Socket::Partial || status == sf::Socket::NotReady;
+    }
+
+    static void report(std::vector<std::unique_ptr<Spectator>>& spectators, double seconds) {
+        long long total = 0, lowest = std::numeric_limits<long long>::max(), highest = 0;
+        for (auto& spectator : spectators) {
+            total += spectator->bytesThisReport;
+            lowest = std::min(lowest, spectator->bytesThisReport);
+            highest = std::max(highest, spectator->bytesThisReport);
+        }
+        std::cout << spectators.size() << " spectators, bytes/s per client: mean " << total / seconds / spectators.size()
+                  << ", min " << lowest / seconds << ", max " << highest / seconds << " (" << total / seconds / 1024 << " KB/s in all)\n";
+        if (spectators.size() <= 8) {
+            for (auto& spectator : spectators) {
+                std::cout << "  Spectator " << spectator->id << ": " << spectator->bytesThisReport / seconds << " bytes/s\n";
+            }
+        }
+        for (auto& spectator : spectators) spectator->bytesThisReport = 0;
+    }
+
+    unsigned short port;
+    sf::TcpListener listener;
+    TripleBuffer<SpectatorState> states;
+    std::atomic<bool> running{ false };
+    std::thread thread;
+};
+
+// Live counters for the metrics endpoint. Each recording thread claims a shard of its
+// own, so recording is a relaxed atomic add on a cache line no other thread writes;
+// the endpoint sums the shards when it is scraped. Gauges are current values, not
+// sums, so they live in one global slot each that the latest setter overwrites.
+enum class Metric { SimulationTicks, Balls, Bricks, Debris, AudioVoices, AudioResidentBytes, MandelbulbPixels, Count };
+enum class Timing { Frame, Tick, Count };
+
+const int metricCount = static_cast<int>(Metric::Count);
+const int timingCount = static_cast<int>(Timing::Count);
+const int timingBucketCount = 10; // The last bucket holds everything slower
+const long long timingBoundsNs[timingCount][timingBucketCount - 1] = {
+    { 4000000, 8000000, 12000000, 16700000, 20000000, 25000000, 33300000, 50000000, 100000000 }, // Frames, around 60 Hz
+    { 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 5000000 },                   // Simulation ticks
+};
+
+std::atomic<long long> metricGauges[metricCount];
+
+struct alignas(64) MetricsShard {
+    std::atomic<long long> values[metricCount];
+    std::atomic<long long> buckets[timingCount][timingBucketCount];
+    std::atomic<long long> sumNs[timingCount];
+    std::atomic<bool> owned; // By a running thread
+
+    void add(Metric metric, long long amount) {
+        values[static_cast<int>(metric)].fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    // A metric is either added to or set, never both
+    void set(Metric metric, long long value) {
+        metricGauges[static_cast<int>(metric)].store(value, std::memory_order_relaxed);
+    }
+
+    void observe(Timing timing, long long ns) {
+        const int t = static_cast<int>(timing);
+        int bucket = 0;
+        while (bucket < timingBucketCount - 1 && ns > timingBoundsNs[t][bucket]) ++bucket;
+        buckets[t][bucket].fetch_add(1, std::memory_order_relaxed);
+        sumNs[t].fetch_add(ns, std::memory_order_relaxed);
+    }
+};
+
+const int maxMetricsShards = 32;
+MetricsShard metricsShards[maxMetricsShards];
+
+// Hands a thread's shard back when the thread ends. Its counts stay in it, and the
+// next thread to claim it adds to them.
+struct MetricsShardClaim {
+    MetricsShard* shard = nullptr;
+
+    ~MetricsShardClaim() {
+        if (shard) shard->owned.store(false, std::memory_order_release);
+    }
+};
+
+// The calling thread's shard, claimed the first time it asks. With every shard owned,
+// threads share the last one, which costs some contention but no lost counts.
+MetricsShard& claimMetricsShard() {
+    thread_local MetricsShardClaim claim;
+    for (int i = 0; !claim.shard && i < maxMetricsShards; ++i) {
+        bool free = false;
+        if (metricsShards[i].owned.compare_exchange_strong(free, true, std::memory_order_acquire)) claim.shard = &metricsShards[i];
+    }
+    return claim.shard ? *claim.shard : metricsShards[maxMetricsShards - 1];
+}
+
+// Physical memory in use by the process, or 0 where the OS doesn't say
+long long residentMemoryBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return static_cast<long long>(counters.WorkingSetSize);
+#elif defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    long long pages = 0, resident = 0;
+    if (statm >> pages >> resident) return resident * sysconf(_SC_PAGESIZE);
+#endif
+    return 0;
+}
+
+// Minimal HTTP endpoint serving the metrics in Prometheus text format at /metrics,
+// one request per connection, from its own thread
+class MetricsServer {
+public:
+    explicit MetricsServer(unsigned short port) : port(port) {}
+
+    ~MetricsServer() {
+        stop();
+    }
+
+    bool start() {
+        if (listener.listen(port) != sf::Socket::Done) {
+            std::cerr << "Can't listen for metrics scrapes on port " << port << "\n";
+            return false;
+        }
+        running = true;
+        thread = std::thread(&MetricsServer::run, this);
+        std::cout << "Serving metrics at http://localhost:" << port << "/metrics\n";
+        return true;
+    }
+
+    void stop() {
+        running = false;
+        if (thread.joinable()) thread.join();
+        listener.close();
+    }
+
+    // The whole exposition: counters summed over every shard, gauges as last set
+    std::string scrape() {
+        long long values[metricCount] = {};
+        long long buckets[timingCount][timingBucketCount] = {};
+        long long sums[timingCount] = {};
+        for (int metric = 0; metric < metricCount; ++metric) values[metric] = metricGauges[metric].load(std::memory_order_relaxed);
+        for (int shard = 0; shard < maxMetricsShards; ++shard) {
+            const MetricsShard& counters = metricsShards[shard];
+            for (int metric = 0; metric < metricCount; ++metric) values[metric] += counters.values[metric].load(std::memory_order_relaxed);
+            for (int timing = 0; timing < timingCount; ++timing) {
+                for (int bucket = 0; bucket < timingBucketCount; ++bucket) buckets[timing][bucket] += counters.buckets[timing][bucket].load(std::memory_order_relaxed);
+                sums[timing] += counters.sumNs[timing].load(std::memory_order_relaxed);
+            }
+        }
+
+        // Pixels a second since the previous scrape, for dashboards that don't take rates
+        long long now = steadyNanoseconds();
+        long long pixels = values[static_cast<int>(Metric::MandelbulbPixels)];
+        double pixelRate = lastScrapeNs != 0 && now > lastScrapeNs ? (pixels - lastPixels) * 1e9 / (now - lastScrapeNs) : 0.0;
+        lastScrapeNs = now;
+        lastPixels = pixels;
+
+        std::ostringstream out;
+        histogram(out, "breakout_frame_seconds", "Time from one window frame to the next.", Timing::Frame, buckets, sums);
+        histogram(out, "breakout_tick_seconds", "Time to step the simulation by one tick.", Timing::Tick, buckets, sums);
+        value(out, "breakout_simulation_ticks_total", "counter", "Simulation ticks stepped.", values[static_cast<int>(Metric::SimulationTicks)]);
+        value(out, "breakout_balls", "gauge", "Balls in play.", values[static_cast<int>(Metric::Balls)]);
+        value(out, "breakout_bricks", "gauge", "Bricks left in the level.", values[static_cast<int>(Metric::Bricks)]);
+        value(out, "breakout_debris", "gauge", "Debris particles alive.", values[static_cast<int>(Metric::Debris)]);
+        value(out, "breakout_audio_voices", "gauge", "Sounds playing.", values[static_cast<int>(Metric::AudioVoices)]);
+        value(out, "breakout_audio_resident_bytes", "gauge", "Sound samples held in memory.", values[static_cast<int>(Metric::AudioResidentBytes)]);
+        value(out, "breakout_mandelbulb_pixels_total", "counter", "Background pixels computed.", pixels);
+        value(out, "breakout_mandelbulb_pixels_per_second", "gauge", "Background pixels computed per second since the last scrape.", pixelRate);
+        if (TRACK_ALLOCATIONS) {
+            value(out, "breakout_heap_allocations_total", "counter", "Calls to operator new.", totalAllocations.load());
+            value(out, "breakout_heap_allocated_bytes_total", "counter", "Bytes requested from operator new.", totalAllocatedBytes.load());
+        }
+        value(out, "breakout_resident_memory_bytes", "gauge", "Physical memory used by the process.", residentMemoryBytes());
+        return out.str();
+    }
+
+private:
+    template <typename T>
+    static void value(std::ostream& out, const char* name, const char* type, const char* help, T number) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n" << name << " " << number << "\n";
+    }
+
+    // Prometheus buckets are cumulative: each counts everything up to its bound
+    static void histogram(std::ostream& out, const char* name, const char* help, Timing timing,
+                          const long long (&buckets)[timingCount][timingBucketCount], const long long (&sums)[timingCount]) {
+        const int t = static_cast<int>(timing);
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " histogram\n";
+        long long count = 0;
+        for (int bucket = 0; bucket < timingBucketCount; ++bucket) {
+            count += buckets[t][bucket];
+            out << name << "_bucket{le=\"";
+            if (bucket < timingBucketCount - 1) out << timingBoundsNs[t][bucket] / 1e9;
+            else out << "+Inf";
+            out << "\"} " << count << "\n";
+        }
+        // The sum grows for as long as the game runs, so print it exactly rather than
+        // to the stream's six significant digits
+        char sum[32];
+        std::snprintf(sum, sizeof(sum), "%lld.%09lld", sums[t] / 1000000000, sums[t] % 1000000000);
+        out << name << "_sum " << sum << "\n" << name << "_count " << count << "\n";
+    }
+
+    void run() {
+        sf::SocketSelector selector;
+        selector.add(listener);
+        while (running) {
+            if (!selector.wait(sf::milliseconds(100)) || !selector.isReady(listener)) continue;
+            sf::TcpSocket client;
+            if (listener.accept(client) == sf::Socket::Done) serve(client);
+        }
+    }
+
+    // Read the request head (giving up after a second), answer it and hang up
+    void serve(sf::TcpSocket& client) {
+        std::string request;
+        char buffer[1024];
+        client.setBlocking(false);
+        const long long deadline = steadyNanoseconds() + 1000000000LL;
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+            if (!running || steadyNanoseconds() > deadline) return;
+            std::size_t received = 0;
+            sf::Socket::Status status = client.receive(buffer, sizeof(buffer), received);
+            if (status == sf::Socket::Done) request.append(buffer, received);
+            else if (status == sf::Socket::NotReady) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            else return;
+        }
+
+        bool found = request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0;
+        std::string body = found ? scrape() : "Metrics are at /metrics\n";
+        std::ostringstream response;
+        response << "HTTP/1.0 " << (found ? "200 OK" : "404 Not Found") << "\r\n"
+                 << "Content-Type: text/plain; version=0.0.4\r\n"
+                 << "Content-Length: " << body.size() << "\r\n"
+                 << "Connection: close\r\n\r\n" << body;
+        const std::string text = response.str();
+        client.setBlocking(true);
+        client.send(text.data(), text.size());
+        client.disconnect();
+    }
+
+    unsigned short port;
+    sf::TcpListener listener;
+    std::atomic<bool> running{ false };
+    std::thread thread;
+    long long lastScrapeNs = 0;
+    long long lastPixels = 0;
+};
+
+// Shared between the render thread (input, drawing) and the update thread (simulation)
+struct SimulationLink {
+    TripleBuffer<GameSnapshot> snapshots;
+    std::atomic<bool> running{ true };
+    std::atomic<bool> paused{ false }; // Set by the update thread at a banner, cleared by the renderer after it
+    std::atomic<bool> inputLeft{ false };
+    std::atomic<bool> inputRight{ false };
+    std::atomic<long long> inputChangedNs{ 0 };
+    SpectatorServer* spectators = nullptr; // Also stream every tick batch here, if set
+
+    void setInput(bool left, bool right) {
+        if (left != inputLeft.load() || right != inputRight.load()) {
+            inputLeft = left;
+            inputRight = right;
+            inputChangedNs = steadyNanoseconds();
+        }
+    }
+};
+
+// Fixed-tick simulation thread: steps the world at 60 Hz of real time regardless of
+// how fast frames are drawn, and publishes a snapshot after every batch of ticks
+void runSimulation(SimulationLink& link, World world, bool aiPlayer) {
+    using clock = std::chrono::steady_clock;
+    const auto tick = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(frameTime));
+    const int maxCatchUpTicks = 5; // Beyond this a stall is dropped instead of fast-forwarded
+
+    AiController ai;
+    FrameEvents events;
+    GameSnapshot totals;
+    MetricsShard& metrics = claimMetricsShard();
+    auto nextTick = clock::now();
+
+    while (link.running) {
+        if (link.paused) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            nextTick = clock::now();
+            continue;
+        }
+        if (clock::now() < nextTick) {
+            std::this_thread::sleep_until(nextTick);
+            continue;
+        }
+
+        long long inputChangedNs = link.inputChangedNs;
+        PaddleInput input;
+        if (aiPlayer) {
+            input = ai.update(world);
+        }
+        else {
+            input.left = link.inputLeft;
+            input.right = link.inputRight;
+        }
+
+        bool banner = false;
+        for (int ticks = 0; ticks < maxCatchUpTicks && clock::now() >= nextTick && !banner; ++ticks) {
+            long long stepStart = steadyNanoseconds();
+            stepWorld(world, input, events);
+            metrics.observe(Timing::Tick, steadyNanoseconds() - stepStart);
+            metrics.add(Metric::SimulationTicks, 1);
+            nextTick += tick;
+
+            accumulateEvents(totals, events);
+            banner = events.levelCleared || events.gameOver;
+        }
+        if (clock::now() >= nextTick) {
+            nextTick = clock::now(); // Still behind after catching up: let the stall go
+        }
+
+        metrics.set(Metric::Balls, static_cast<long long>(world.balls.size()));
+        metrics.set(Metric::Bricks, static_cast<long long>(world.bricks.size()));
+
+        fillSnapshot(link.snapshots.writeSlot(), totals, world, inputChangedNs);
+        if (link.spectators) link.spectators->publish(world);
+
+        // Pause before publishing so the renderer cannot resume us before we stop
+        if (banner) link.paused = true;
+        link.snapshots.publish();
+        if (world.gameOver) break;
+    }
+}
+
+// Frame times in 0.1 ms buckets up to 100 ms, so percentiles need no per-frame storage
+struct FrameTimeStats {
+    static const int bucketCount = 1001; // The last bucket holds everything slower
+    long long buckets[bucketCount] = {};
+    long long count = 0;
+    double maxMs = 0.0;
+
+    void record(double ms) {
+        ++buckets[std::min(bucketCount - 1, static_cast<int>(ms * 10.0))];
+        ++count;
+        maxMs = std::max(maxMs, ms);
+    }
+
+    double percentile(double share) const {
+        long long target = static_cast<long long>(share * count);
+        long long seen = 0;
+        for (int bucket = 0; bucket < bucketCount; ++bucket) {
+            seen += buckets[bucket];
+            if (seen > target) return bucket / 10.0;
+        }
+        return maxMs;
+    }
+
+    void print(const char* label) const {
+        std::cout << label << ": p50 " << percentile(0.5) << " ms, p99 " << percentile(0.99) << " ms, max " << maxMs
+                  << " ms over " << count << " frames\n";
+    }
+};
+
+// Ask the OS to run the calling thread only when nothing more important wants the CPU
+void lowerThreadPriority() {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_IDLE);
+#elif defined(__linux__)
+    sched_param param = {};
+    pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#endif
+}
+
+// Background: a slowly zooming Mandelbulb slice behind the bricks
+const int backgroundWidth = 200;  // A quarter of the window, scaled up when drawn
+const int backgroundHeight = 150;
+const int backgroundIterations = 40;
+const float backgroundPower = 8.0f;
+const float backgroundBrightness = 0.45f;     // Dimmed so the bricks stand out
+const long long fastestBackgroundNs = 100000000LL; // 10 images a second at best
+const long long slowestBackgroundNs = 2000000000LL;
+
+// Computes background images on idle-priority threads, each allowed only a share of
+// every 60 Hz frame, and hands finished images over through a triple buffer so the
+// window never waits for one. When an image misses its deadline or the game drops
+// frames, images come less often instead.
+class FractalBackground {
+public:
+    FractalBackground(int threads, float budgetShare)
+        : threadCount(std::max(1, threads)), budgetNs(static_cast<long long>(budgetShare * frameTime * 1e9)) {
+        images.reset(std::vector<sf::Uint8>(static_cast<size_t>(backgroundWidth) * backgroundHeight * 4, 0));
+    }
+
+    ~FractalBackground() {
+        stop();
+    }
+
+    void start() {
+        running = true;
+        workers.emplace_back(&FractalBackground::leaderLoop, this);
+        for (int thread = 1; thread < threadCount; ++thread) {
+            workers.emplace_back(&FractalBackground::helperLoop, this);
+        }
+    }
+
+    void stop() {
+        running = false;
+        for (auto& worker : workers) worker.join();
+        workers.clear();
+    }
+
+    // Window thread: true if a newer image has been swapped in
+    bool update() {
+        return images.update();
+    }
+
+    // RGBA pixels of the newest image
+    const std::vector<sf::Uint8>& pixels() const {
+        return images.readSlot();
+    }
+
+    // Window thread: a frame took well over its time, so back off
+    void reportOverrun() {
+        ++overruns;
+    }
+
+    void printStats() const {
+        std::cout << "Background: " << imagesDone << " images, mean " << (imagesDone > 0 ? totalImageNs / imagesDone / 1e6 : 0.0)
+                  << " ms, slowest " << maxImageNs / 1e6 << " ms to build; " << threadCount << " threads, " << budgetNs / 1e6
+                  << " ms each per frame, waited for budget " << budgetWaits << " times; slowed down " << degradations
+                  << " times, now " << 1e9 / intervalNs << " images/s" << std::endl;
+    }
+
+private:
+    // Time used by one thread in the current 60 Hz slice
+    struct BudgetSlice {
+        long long slice = -1;
+        long long usedNs = 0;
+    };
+
+    static double zoomAt(double seconds) {
+        return 0.6 * std::exp(1.2 * (1.0 - std::cos(seconds * 0.1))); // In and out again about once a minute
+    }
+
+    // Sleep to the next 60 Hz slice once this thread has used its share of the current one
+    void waitForBudget(BudgetSlice& budget) {
+        const long long sliceNs = static_cast<long long>(frameTime * 1e9);
+        long long slice = steadyNanoseconds() / sliceNs;
+        if (slice != budget.slice) {
+            budget.slice = slice;
+            budget.usedNs = 0;
+        }
+        if (budget.usedNs >= budgetNs) {
+            ++budgetWaits;
+            std::this_thread::sleep_for(std::chrono::nanoseconds((slice + 1) * sliceNs - steadyNanoseconds()));
+            budget.slice = slice + 1;
+            budget.usedNs = 0;
+        }
+    }
+
+    void renderRow(std::vector<sf::Uint8>& image, int row, double currentZoom) {
+        const float rangeX = static_cast<float>(3.0 / currentZoom);
+        const float rangeY = rangeX * backgroundHeight / backgroundWidth;
+        const float centerX = 0.1f, centerY = 0.35f, sliceZ = 0.2f;
+
+        float y = centerY - rangeY / 2 + row * rangeY / backgroundHeight;
+        sf::Uint8* pixel = &image[static_cast<size_t>(row) * backgroundWidth * 4];
+        for (int x = 0; x < backgroundWidth; ++x, pixel += 4) {
+            float px = centerX - rangeX / 2 + x * rangeX / backgroundWidth;
+            int iterations = mandelbulb(px, y, sliceZ, backgroundIterations, backgroundPower);
+            sf::Color color = getColor(iterations, backgroundIterations, 2.0); // Escape radius stands in for |z|
+            pixel[0] = static_cast<sf::Uint8>(color.r * backgroundBrightness);
+            pixel[1] = static_cast<sf::Uint8>(color.g * backgroundBrightness);
+            pixel[2] = static_cast<sf::Uint8>(color.b * backgroundBrightness);
+            pixel[3] = 255;
+        }
+    }
+
+    // Take rows of the current image until none are left
+    void renderRows(BudgetSlice& budget, MetricsShard& metrics) {
+        while (nextRow.load() < backgroundHeight) {
+            int row = nextRow.fetch_add(1);
+            if (row >= backgroundHeight) return;
+            waitForBudget(budget);
+            long long start = steadyNanoseconds();
+            renderRow(*target.load(), row, zoom.load());
+            budget.usedNs += steadyNanoseconds() - start;
+            rowsDone.fetch_add(1);
+            metrics.add(Metric::MandelbulbPixels, backgroundWidth);
+        }
+    }
+
+    // Starts each image, helps render it, publishes it and sets the pace for the next
+    void leaderLoop() {
+        lowerThreadPriority();
+        BudgetSlice budget;
+        MetricsShard& metrics = claimMetricsShard();
+        const long long startNs = steadyNanoseconds();
+        long long nextImageNs = startNs;
+        long long seenOverruns = 0;
+
+        while (running) {
+            long long now = steadyNanoseconds();
+            if (now < nextImageNs) {
+                std::this_thread::sleep_for(std::chrono::nanoseconds(std::min(nextImageNs - now, 5000000LL)));
+                continue;
+            }
+
+            // Parameters first: the reset of nextRow is what lets helpers in
+            zoom = zoomAt((now - startNs) / 1e9);
+            target = &images.writeSlot();
+            rowsDone = 0;
+            nextRow = 0;
+            renderRows(budget, metrics);
+            while (running && rowsDone.load() < backgroundHeight) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (!running) break;
+            images.publish();
+
+            long long imageNs = steadyNanoseconds() - now;
+            ++imagesDone;
+            totalImageNs += imageNs;
+            maxImageNs = std::max(maxImageNs, imageNs);
+
+            // Missed the deadline, or the game is struggling: halve the update rate.
+            // Well inside it: speed back up a little at a time.
+            long long currentOverruns = overruns.load();
+            if (imageNs > intervalNs || currentOverruns != seenOverruns) {
+                intervalNs = std::min(intervalNs * 2, slowestBackgroundNs);
+                ++degradations;
+            }
+            else if (imageNs * 2 < intervalNs) {
+                intervalNs = std::max(intervalNs * 3 / 4, fastestBackgroundNs);
+            }
+            seenOverruns = currentOverruns;
+            nextImageNs = now + intervalNs;
+        }
+    }
+
+    void helperLoop() {
+        lowerThreadPriority();
+        BudgetSlice budget;
+        MetricsShard& metrics = claimMetricsShard();
+        while (running) {
+            renderRows(budget, metrics);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    TripleBuffer<std::vector<sf::Uint8>> images;
+    std::vector<std::thread> workers;
+    const int threadCount;
+    const long long budgetNs;
+
+    // The image being built
+    std::atomic<bool> running{ false };
+    std::atomic<int> nextRow{ backgroundHeight }; // Past the end: nothing to do
+    std::atomic<int> rowsDone{ 0 };
+    std::atomic<double> zoom{ 1.0 };
+    std::atomic<std::vector<sf::Uint8>*> target{ nullptr };
+    std::atomic<long long> overruns{ 0 };
+    std::atomic<long long> budgetWaits{ 0 };
+
+    // Pace and stats, owned by the leader thread
+    long long intervalNs = fastestBackgroundNs;
+    long long imagesDone = 0;
+    long long totalImageNs = 0;
+    long long maxImageNs = 0;
+    long long degradations = 0;
+};
+
+// Run the simulation and the allocation-sensitive parts of the render path
+// headless, and fail if any steady-state frame touches the heap
+int runAllocationBenchmark(long long frames) {
+    const long long warmupFrames = 600; // Ten seconds, long enough for the falling row to start
+    if (!TRACK_ALLOCATIONS) {
+        std::cerr << "Allocations aren't counted in this build; use a debug build or define TRACK_ALLOCATIONS=1\n";
+        return 1;
+    }
+
+    World world;
+    AiController ai;
+    FrameEvents events;
+    GameSnapshot totals;
+    TripleBuffer<GameSnapshot> snapshots;
+    GameSnapshot previous, current;
+    resetLevel(world);
+
+    long long allocatingFrames = 0;
+    long long steadyAllocations = 0;
+    long long levelChanges = 0;
+    long long levelChangeAllocations = 0;
+
+    for (long long frame = 0; frame < warmupFrames + frames && !world.gameOver; ++frame) {
+        long long before = threadAllocations;
+
+        // Update thread's share of a frame
+        stepWorld(world, ai.update(world), events);
+        accumulateEvents(totals, events);
+        fillSnapshot(snapshots.writeSlot(), totals, world, 0);
+        snapshots.publish();
+
+        // Render thread's share, minus the window
+        if (snapshots.update()) {
+            std::swap(previous, current);
+            current = snapshots.readSlot();
+        }
+        for (const auto& position : events.destroyedBricks) {
+            spawnDebris(debris, position, brickHitDebris);
+        }
+        updateDebris(debris, frameTime);
+
+        long long allocations = threadAllocations - before;
+        if (frame < warmupFrames) continue;
+        if (events.levelCleared) {
+            // A new level may need room for another row of bricks; that is not a steady-state frame
+            ++levelChanges;
+            levelChangeAllocations += allocations;
+        }
+        else if (allocations > 0) {
+            ++allocatingFrames;
+            steadyAllocations += allocations;
+        }
+    }
+
+    std::cout << "Allocation benchmark: " << frames << " frames after " << warmupFrames << " warm-up frames\n";
+    std::cout << "  steady-state frames that allocated: " << allocatingFrames << " (" << steadyAllocations << " allocations)\n";
+    std::cout << "  level changes: " << levelChanges << " (" << levelChangeAllocations << " allocations)\n";
+    std::cout << "  process total: " << totalAllocations << " allocations, " << totalAllocatedBytes << " bytes\n";
+
+    if (allocatingFrames > 0) {
+        std::cout << "FAIL: steady-state frames allocated" << std::endl;
+        return 1;
+    }
+    std::cout << "PASS" << std::endl;
+    return 0;
+}
+
+// Run the 60 Hz game tick alone and then next to the background threads, and compare
+// how late ticks start and how long they take. The background must not change either.
+int runBackgroundBenchmark(double seconds, int threads, float budgetShare) {
+    using clock = std::chrono::steady_clock;
+    const auto tick = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(frameTime));
+
+    auto measure = [&](FractalBackground* background, const char* label) {
+        World world;
+        AiController ai;
+        FrameEvents events;
+        resetLevel(world);
+        FrameTimeStats lateness, work;
+        long long newImages = 0;
+
+        auto next = clock::now();
+        const auto end = next + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(seconds));
+        while (next < end) {
+            std::this_thread::sleep_until(next);
+            auto start = clock::now();
+            lateness.record(std::chrono::duration<double, std::milli>(start - next).count());
+
+            stepWorld(world, ai.update(world), events);
+            if (world.gameOver) {
+                world = World();
+                resetLevel(world);
+            }
+            if (background && background->update()) ++newImages;
+
+            work.record(std::chrono::duration<double, std::milli>(clock::now() - start).count());
+            next += tick;
+        }
+        std::cout << label << "\n";
+        lateness.print("  tick start lateness");
+        work.print("  tick time");
+        if (background) std::cout << "  " << newImages << " background images picked up\n";
+    };
+
+    measure(nullptr, "Game tick alone:");
+
+    FractalBackground background(threads, budgetShare);
+    background.start();
+    measure(&background, "Game tick with the fractal background:");
+    background.stop();
+    background.printStats();
+    return 0;
+}
+
+sf::Vector2f lerp(const sf::Vector2f& a, const sf::Vector2f& b, float t) {
+    return a + (b - a) * t;
+}
+
+// One frame of play: background, paddle, bricks, balls, debris and the score line,
+// with the paddle and balls blended between the last two simulation states
+void drawScene(RenderBackend& renderer, const GameSnapshot& previous, const GameSnapshot& current, float alpha, const Hud& hud,
+               const std::vector<sf::Uint8>* background, bool backgroundChanged) {
+    static const sf::Color brickColors[] = { sf::Color::Red, sf::Color::Yellow, sf::Color::Green, sf::Color::Blue, sf::Color::Magenta, sf::Color::White, sf::Color::Red, sf::Color::Black };
+
+    renderer.clear(sf::Color::Black);
+    if (background) {
+        renderer.image(background->data(), backgroundWidth, backgroundHeight, sf::Vector2f(0, 0),
+                       sf::Vector2f(800.0f / backgroundWidth, 600.0f / backgroundHeight), backgroundChanged);
+    }
+    renderer.rect(lerp(previous.paddlePosition, current.paddlePosition, alpha), sf::Vector2f(paddleWidth, paddleHeight), sf::Color::Green);
+    for (const auto& b : current.bricks) {
+        renderer.rect(b.position, sf::Vector2f(brickWidth, brickHeight), brickColors[b.colorIndex]);
+    }
+    bool sameBalls = previous.ballPositions.size() == current.ballPositions.size();
+    for (size_t i = 0; i < current.ballPositions.size(); ++i) {
+        sf::Vector2f position = sameBalls ? lerp(previous.ballPositions[i], current.ballPositions[i], alpha) : current.ballPositions[i];
+        renderer.circle(position, ballRadius, sf::Color::Red);
+    }
+    renderDebris(renderer, debris);
+    hud.draw(renderer);
+}
+
+// Play a fixed AI game through the software renderer, from the READY? banner until it
+// ends or `frames` frames have been drawn, and save every `every`-th frame as
+// dir/frame_NNNNN.bmp. With check set, compare against the saved frames instead; any
+// differing pixel fails, and the frame we drew is saved next to it as actual_NNNNN.bmp.
+int runGoldenFrames(const std::string& dir, long long frames, int every, bool check) {
+    std::srand(1);
+    debris.clear();
+
+    SoftwareBackend renderer(800, 600);
+    long long saved = 0, compared = 0, failed = 0;
+    renderer.setFrameHandler([&](const SoftwareBackend& frame) {
+        long long index = frame.getFrames();
+        if (index % every != 0) return;
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%05lld.bmp", index);
+        std::string path = dir + name;
+
+        if (!check) {
+            if (frame.save(path)) ++saved;
+            else std::cerr << "Can't write " << path << "\n";
+            return;
+        }
+
+        int goldenWidth = 0, goldenHeight = 0;
+        std::vector<std::uint8_t> golden;
+        ++compared;
+        if (!loadBmp(path, goldenWidth, goldenHeight, golden) || goldenWidth != frame.getWidth() || goldenHeight != frame.getHeight()) {
+            std::cout << path << ": missing or a different size\n";
+            ++failed;
+            return;
+        }
+        std::vector<std::uint8_t> actual(golden.size());
+        frame.toBgr(actual.data());
+        long long differing = 0;
+        for (size_t i = 0; i < golden.size(); i += 3) {
+            if (golden[i] != actual[i] || golden[i + 1] != actual[i + 1] || golden[i + 2] != actual[i + 2]) ++differing;
+        }
+        if (differing > 0) {
+            std::snprintf(name, sizeof(name), "/actual_%05lld.bmp", index);
+            frame.save(dir + name);
+            std::cout << path << ": " << differing << " pixels differ\n";
+            ++failed;
+        }
+    });
+
+    displayReadyMessage(renderer);
+
+    World world;
+    AiController ai;
+    FrameEvents events;
+    GameSnapshot totals, snapshot;
+    Hud hud;
+    resetLevel(world);
+    while (renderer.getFrames() < frames) {
+        stepWorld(world, ai.update(world), events);
+        accumulateEvents(totals, events);
+        fillSnapshot(snapshot, totals, world, 0);
+        for (const auto& position : events.destroyedBricks) {
+            spawnDebris(debris, position, brickHitDebris);
+        }
+        updateDebris(debris, frameTime);
+        hud.update(snapshot.score, snapshot.remainingBalls, snapshot.level);
+
+        drawScene(renderer, snapshot, snapshot, 1.0f, hud, nullptr, false);
+        renderer.display();
+
+        if (events.gameOver) {
+            displayYouSuckMessage(renderer);
+            break;
+        }
+        if (events.levelCleared) {
+            displayYouWonMessage(renderer);
+        }
+    }
+
+    if (!check) {
+        std::cout << "Saved " << saved << " golden frames of " << renderer.getFrames() << " to " << dir << std::endl;
+        return 0;
+    }
+    std::cout << (failed == 0 ? "PASS" : "FAIL") << ": " << compared - failed << " of " << compared << " golden frames match" << std::endl;
+    return failed == 0 ? 0 : 1;
+}
+
+// Software rendering speed on a busy frame (a deep brick wall, the background image and
+// a pool full of half-faded debris), with and without the SSE2 spans
+int runRasterBenchmark(int frames) {
+    World world;
+    for (int level = 0; level < 5; ++level) resetLevel(world); // More rows of bricks
+    GameSnapshot totals, snapshot;
+    fillSnapshot(snapshot, totals, world, 0);
+    Hud hud;
+    hud.update(snapshot.score, snapshot.remainingBalls, snapshot.level);
+
+    std::srand(1);
+    debris.clear();
+    while (debris.size() + brickHitDebris <= maxDebris) {
+        spawnDebris(debris, sf::Vector2f(static_cast<float>(std::rand() % 800), static_cast<float>(std::rand() % 600)), brickHitDebris);
+    }
+    updateDebris(debris, 0.2f);
+
+    std::vector<sf::Uint8> background(static_cast<size_t>(backgroundWidth) * backgroundHeight * 4);
+    for (size_t i = 0; i < background.size(); ++i) {
+        background[i] = static_cast<sf::Uint8>(i % 4 == 3 ? 255 : i * 7);
+    }
+
+    std::vector<sf::Uint32> reference;
+    for (int simd = 0; simd <= RASTER_SSE2; ++simd) {
+        SoftwareBackend renderer(800, 600);
+        renderer.setSimd(simd != 0);
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            drawScene(renderer, snapshot, snapshot, 1.0f, hud, &background, false);
+            renderer.display();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << (simd ? "SSE2:   " : "Scalar: ") << seconds * 1000.0 / frames << " ms/frame, "
+                  << renderer.getPixelsFilled() / seconds / 1e6 << " Mpixels/s filled ("
+                  << debris.size() << " debris, " << snapshot.bricks.size() << " bricks)\n";
+        if (simd == 0) {
+            reference = renderer.getPixels();
+        }
+        else if (renderer.getPixels() != reference) {
+            std::cout << "FAIL: SSE2 and scalar frames differ" << std::endl;
+            return 1;
+        }
+    }
+    if (RASTER_SSE2) std::cout << "SSE2 and scalar frames are identical" << std::endl;
+    return 0;
+}
+
+// Ball kernel speed over growing numbers of balls, scalar against SIMD: moveBalls on its
+// own, then whole frames with removeLostBalls, topping lost balls up from a fixed supply
+// so the count holds steady
+int runBallBenchmark(int maxBalls) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> across(ballRadius, 800 - ballRadius), down(ballRadius, 540.0f), speed(-6.0f, 6.0f);
+    const size_t supply = 4096;
+    BallSet spares;
+    for (size_t i = 0; i < supply; ++i) spares.push(sf::Vector2f(across(rng), down(rng)), sf::Vector2f(speed(rng), speed(rng)));
+    const sf::Vector2f paddle(300, 550);
+    const float multiplier = 1.3f;
+
+    std::cout << "Ball kernel: " << (BALLS_SIMD == 8 ? "AVX, 8" : BALLS_SIMD == 4 ? "SSE2, 4" : "no SIMD, 1") << " balls per step\n";
+    bool identical = true;
+    std::vector<int> counts = { 1, 8, 100, 1000, 10000, 100000 };
+    counts.erase(std::remove_if(counts.begin(), counts.end(), [&](int n) { return n >= maxBalls; }), counts.end());
+    counts.push_back(std::max(1, maxBalls));
+
+    for (int count : counts) {
+        BallSet start;
+        for (int i = 0; i < count; ++i) start.push(sf::Vector2f(across(rng), down(rng)), sf::Vector2f(speed(rng), speed(rng)));
+        const long long frames = std::max(100LL, 20000000LL / count); // About 20 million ball moves per run
+
+        double moveNs[2] = {}, frameNs[2] = {};
+        BallSet results[2];
+        long long hits[2] = {}, lost = 0;
+        for (int simd = 0; simd <= (BALLS_SIMD ? 1 : 0); ++simd) {
+            BallSet balls = start;
+            auto begin = std::chrono::steady_clock::now();
+            for (long long f = 0; f < frames; ++f) moveBalls(balls, multiplier, paddle, simd != 0);
+            moveNs[simd] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / (static_cast<double>(frames) * count);
+
+            balls = start;
+            balls.reserve(count + supply);
+            size_t nextSpare = 0;
+            begin = std::chrono::steady_clock::now();
+            for (long long f = 0; f < frames; ++f) {
+                hits[simd] += moveBalls(balls, multiplier, paddle, simd != 0);
+                for (size_t gone = removeLostBalls(balls, simd != 0); gone > 0; --gone, ++nextSpare) {
+                    balls.push(spares.position(nextSpare % supply), spares.velocity(nextSpare % supply));
+                }
+            }
+            frameNs[simd] = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / (static_cast<double>(frames) * count);
+            results[simd] = balls;
+            lost = static_cast<long long>(nextSpare);
+        }
+
+        std::cout << "  " << count << " balls, " << static_cast<double>(lost) / frames << " lost a frame: move " << moveNs[0];
+        if (BALLS_SIMD) std::cout << " -> " << moveNs[1] << " ns/ball (" << moveNs[0] / moveNs[1] << "x)";
+        std::cout << ", whole frame " << frameNs[0];
+        if (BALLS_SIMD) std::cout << " -> " << frameNs[1] << " ns/ball (" << frameNs[0] / frameNs[1] << "x)";
+        std::cout << std::endl;
+
+        identical = identical && hits[0] == hits[BALLS_SIMD ? 1 : 0] && results[0].x == results[BALLS_SIMD ? 1 : 0].x
+                    && results[0].y == results[BALLS_SIMD ? 1 : 0].y && results[0].vx == results[BALLS_SIMD ? 1 : 0].vx
+                    && results[0].vy == results[BALLS_SIMD ? 1 : 0].vy;
+    }
+
+    if (!identical) {
+        std::cout << "FAIL: SIMD and scalar balls differ" << std::endl;
+        return 1;
+    }
+    if (BALLS_SIMD) std::cout << "SIMD and scalar balls are identical" << std::endl;
+    return 0;
+}
+
+// Debris systems over a large field, run stage by stage on one thread and then with
+// each stage's systems spread over worker threads. Expired particles are topped up
+// from the same random stream in both runs, so the fields must end up identical.
+int runEcsBenchmark(int entities, int frames) {
+    entities = std::max(1, entities);
+    frames = std::max(1, frames);
+    double frameMs[2] = {};
+    double checksum[2] = {};
+    size_t finalCount[2] = {};
+    for (int parallel = 0; parallel <= 1; ++parallel) {
+        DebrisField field(static_cast<size_t>(entities));
+        if (parallel == 0) {
+            std::cout << "Debris systems, " << entities << " entities:\n";
+            field.printPlan(std::cout);
+        }
+        std::srand(11);
+        while (field.size() < static_cast<size_t>(entities)) spawnDebris(field, sf::Vector2f(400, 300), brickHitDebris);
+
+        double total = 0;
+        for (int f = 0; f < frames; ++f) {
+            auto begin = std::chrono::steady_clock::now();
+            field.update(frameTime, parallel != 0);
+            total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+            while (field.size() < static_cast<size_t>(entities)) spawnDebris(field, sf::Vector2f(400, 300), brickHitDebris);
+        }
+        frameMs[parallel] = total / frames;
+        field.each([&](Entity, const Position& position, const Spin& spin, const Look& look) {
+            checksum[parallel] += position.value.x + position.value.y + spin.rotation + look.color.a;
+        });
+        finalCount[parallel] = field.size();
+    }
+
+    std::cout << "  sequential " << frameMs[0] << " ms/frame, parallel " << frameMs[1] << " ms/frame ("
+              << frameMs[0] / frameMs[1] << "x)" << std::endl;
+    if (checksum[0] != checksum[1] || finalCount[0] != finalCount[1]) {
+        std::cout << "FAIL: sequential and parallel debris differ" << std::endl;
+        return 1;
+    }
+    std::cout << "Sequential and parallel debris are identical" << std::endl;
+    return 0;
+}
+
+// Assets live in one bundle, packed from the loose files with --pack-assets; without
+// the bundle, or where a loose file under assetRoot has changed since it was packed,
+// they are loaded from the loose files
+const char* const assetRoot = "C:/Users/abroadbent/source/repos/BMP_Create/";
+const char* const assetBundleFile = "C:/Users/abroadbent/source/repos/BMP_Create/assets.bundle";
+
+// Every asset the game loads, by its path under assetRoot, which is also its name in the bundle
+const char* const fontAsset = "font/arial.ttf";
+const char* const scoreSoundAsset = "wav/score.wav";
+const char* const loseBallSoundAsset = "wav/lose_ball.wav";
+const char* const hitBallSoundAsset = "wav/hit_ball.wav";
+const char* const ready3SoundAsset = "wav/ready3.wav";
+const char* const winSoundAsset = "wav/win.wav";
+const char* const soundAssets[] = { scoreSoundAsset, loseBallSoundAsset, hitBallSoundAsset, ready3SoundAsset, winSoundAsset };
+
+AssetBundle assets; // Stays mapped for the whole run: fonts read their data from it
+
+bool loadFont(sf::Font& font, const char* name) {
+    if (const BundleEntry* entry = assets.find(name, BundleKind::Font)) {
+        return font.loadFromMemory(assets.data(*entry), static_cast<std::size_t>(entry->size));
+    }
+    return font.loadFromFile(std::string(assetRoot) + name);
+}
+
+// Audio policy: short effects stay resident as compact mono PCM at the output rate;
+// clips longer than streamAboveSeconds are streamed a chunk at a time. An effect not
+// played for a while is dropped. Loading one again allocates and decodes, so play()
+// never does it: banners bring every dropped effect back, and one played before then
+// is loaded by the next update() and plays a frame late. Streams hold only a few
+// chunks, so they are never dropped.
+const double streamAboveSeconds = 2.0;
+const unsigned effectSampleRate = 44100;            // OpenAL Soft's default mixing rate, so effects aren't resampled again
+const long long evictAudioAfterNs = 60000000000LL; // A minute without playing
+const unsigned streamChunksPerSecond = 10;         // 100 ms chunks
+
+// Interleaved 16-bit PCM played straight out of the mapped bundle, handing SFML one
+// small chunk at a time instead of copying the whole clip. OpenAL has its own copy of
+// a chunk once the next one is asked for, so the pages behind it are released then.
+class PcmStream : public sf::SoundStream {
+public:
+    // SFML's streaming thread calls onGetData, so it has to stop before this part is gone
+    ~PcmStream() {
+        stop();
+    }
+
+    void open(const sf::Int16* samples, std::size_t count, unsigned channels, unsigned sampleRate) {
+        stop();
+        this->samples = samples;
+        this->count = count - count % channels;
+        this->channels = channels;
+        this->sampleRate = sampleRate;
+        chunkSamples = std::max<std::size_t>(channels, sampleRate / streamChunksPerSecond * channels);
+        position = 0;
+        released = 0;
+        initialize(channels, sampleRate);
+    }
+
+    std::size_t chunkBytes() const { return chunkSamples * sizeof(sf::Int16); }
+
+    // Release the pages of everything handed out so far, which onGetData leaves for the
+    // newest chunk. Only while stopped, when SFML's thread isn't reading it.
+    void releasePlayed() {
+        if (position <= released) return;
+        const void* end = AssetBundle::release(samples + released, (position - released) * sizeof(sf::Int16));
+        released = static_cast<std::size_t>(static_cast<const sf::Int16*>(end) - samples); // Page aligned, and samples are 64-byte aligned
+    }
+
+protected:
+    bool onGetData(Chunk& chunk) override {
+        releasePlayed(); // The previous chunk is in OpenAL's buffers by now
+        chunk.samples = samples + position;
+        chunk.sampleCount = std::min(chunkSamples, count - position);
+        position += chunk.sampleCount;
+        return position < count;
+    }
+
+    void onSeek(sf::Time offset) override {
+        std::size_t frame = static_cast<std::size_t>(std::max<sf::Int64>(0, offset.asMicroseconds()) * sampleRate / 1000000);
+        releasePlayed(); // SFML stops its thread before seeking
+        position = std::min(count, frame * channels);
+        released = position;
+    }
+
+private:
+    const sf::Int16* samples = nullptr;
+    std::size_t count = 0;
+    unsigned channels = 1;
+    unsigned sampleRate = 44100;
+    std::size_t chunkSamples = 0;
+    std::size_t position = 0;
+    std::size_t released = 0; // Pages before this sample have been released
+};
+
+// Mix interleaved samples down to mono and resample them linearly to effectSampleRate
+std::vector<sf::Int16> compactEffect(const sf::Int16* samples, std::size_t count, unsigned channels, unsigned sampleRate) {
+    const std::size_t frames = channels > 0 ? count / channels : 0;
+    if (frames == 0 || sampleRate == 0) return std::vector<sf::Int16>();
+    auto mono = [&](std::size_t frame) {
+        int sum = 0;
+        for (unsigned channel = 0; channel < channels; ++channel) sum += samples[frame * channels + channel];
+        return static_cast<float>(sum) / channels;
+    };
+
+    std::vector<sf::Int16> compact(static_cast<std::size_t>(static_cast<std::uint64_t>(frames) * effectSampleRate / sampleRate));
+    for (std::size_t i = 0; i < compact.size(); ++i) {
+        double source = static_cast<double>(i) * sampleRate / effectSampleRate;
+        std::size_t first = static_cast<std::size_t>(source);
+        std::size_t second = std::min(first + 1, frames - 1);
+        float t = static_cast<float>(source - first);
+        float a = mono(first), b = mono(second);
+        compact[i] = static_cast<sf::Int16>(std::lround(a + (b - a) * t));
+    }
+    return compact;
+}
+
+// Every sound the game plays, loaded by the policy above
+class AudioLibrary {
+public:
+    explicit AudioLibrary(long long evictAfterNs = evictAudioAfterNs) : evictAfterNs(evictAfterNs) {}
+
+    // Returns the id to play it by, or -1 if it can't be loaded
+    int add(const char* name) {
+        std::unique_ptr<Clip> clip(new Clip);
+        clip->name = name;
+        if (const BundleEntry* entry = assets.find(name, BundleKind::Sound)) {
+            clip->decodedBytes = static_cast<std::size_t>(entry->size);
+            clip->seconds = static_cast<double>(entry->size) / sizeof(sf::Int16) / std::max(1u, entry->channels) / std::max(1u, entry->sampleRate);
+        }
+        else {
+            sf::InputSoundFile file;
+            if (!file.openFromFile(std::string(assetRoot) + name)) return -1;
+            clip->decodedBytes = static_cast<std::size_t>(file.getSampleCount()) * sizeof(sf::Int16);
+            clip->seconds = static_cast<double>(file.getSampleCount()) / std::max(1u, file.getChannelCount()) / std::max(1u, file.getSampleRate());
+        }
+        clip->streamed = clip->seconds > streamAboveSeconds;
+        if (!load(*clip)) return -1;
+        clips.push_back(std::move(clip));
+        return static_cast<int>(clips.size()) - 1;
+    }
+
+    void play(int id) {
+        Clip& clip = *clips[id];
+        clip.lastPlayedNs = steadyNanoseconds();
+        if (clip.loaded) start(clip);
+        else clip.deferred = true; // Dropped; update() loads it and plays it then
+    }
+
+    // Once a frame: play anything that was asked for while dropped, hand back the bundle
+    // pages of streams that have finished, and drop effects that have gone unplayed for
+    // too long
+    void update() {
+        long long now = steadyNanoseconds();
+        for (auto& clip : clips) {
+            if (clip->deferred) {
+                clip->deferred = false;
+                if (clip->loaded || load(*clip)) start(*clip);
+            }
+            else if (clip->pcm && clip->pcm->getStatus() == sf::SoundSource::Stopped) {
+                clip->pcm->releasePlayed(); // Not while paused: SFML's thread still owns the read position
+            }
+            else if (clip->loaded && !clip->streamed && !playing(*clip) && now - clip->lastPlayedNs > evictAfterNs) {
+                unload(*clip);
+            }
+        }
+    }
+
+    // At a banner, which holds the frame up anyway: load every dropped effect again,
+    // so the next level doesn't have to
+    void reloadDropped() {
+        for (auto& clip : clips) {
+            if (!clip->loaded) load(*clip);
+        }
+    }
+
+    int voicesPlaying() const {
+        int voices = 0;
+        for (auto& clip : clips) voices += playing(*clip);
+        return voices;
+    }
+
+    // PCM in memory: whole compact effects, and a few chunks per stream in SFML, OpenAL
+    // and the bundle mapping. Bundle pages are released once copied out or played.
+    std::size_t residentBytes() const {
+        std::size_t bytes = 0;
+        for (auto& clip : clips) bytes += clip->loaded ? clip->residentBytes : 0;
+        return bytes;
+    }
+
+    void printMemory(std::ostream& out) const {
+        std::size_t decoded = 0;
+        for (auto& clip : clips) decoded += clip->decodedBytes;
+        out << "Audio: " << residentBytes() / 1024 << " KB resident, " << decoded / 1024 << " KB if every clip were fully decoded\n";
+        for (auto& clip : clips) {
+            out << "  " << clip->name << ": " << clip->seconds << " s, " << (clip->streamed ? "streamed" : "compact effect") << ", "
+                << (clip->loaded ? clip->residentBytes / 1024 : 0) << " KB" << (clip->loaded ? "" : " (evicted)") << "\n";
+        }
+    }
+
+private:
+    struct Clip {
+        const char* name = "";
+        bool streamed = false;
+        bool loaded = false;
+        bool deferred = false; // Played while dropped
+        double seconds = 0;
+        std::size_t decodedBytes = 0;  // The whole clip as 16-bit PCM at its own rate and channels
+        std::size_t residentBytes = 0;
+        long long lastPlayedNs = 0;
+        std::unique_ptr<sf::SoundBuffer> buffer; // Effects
+        std::unique_ptr<sf::Sound> sound;
+        std::unique_ptr<sf::SoundStream> stream;  // Long clips: PcmStream over the bundle, or Music over the loose file
+        PcmStream* pcm = nullptr;                 // stream, when it is a PcmStream
+    };
+
+    static void start(Clip& clip) {
+        if (clip.streamed) clip.stream->play();
+        else clip.sound->play();
+    }
+
+    static bool playing(const Clip& clip) {
+        if (!clip.loaded) return false;
+        return (clip.streamed ? clip.stream->getStatus() : clip.sound->getStatus()) == sf::SoundSource::Playing;
+    }
+
+    bool load(Clip& clip) {
+        const BundleEntry* entry = assets.find(clip.name, BundleKind::Sound);
+        if (clip.streamed) {
+            // SFML keeps one chunk and OpenAL queues three more
+            const int chunksHeld = 4;
+            if (entry) {
+                std::unique_ptr<PcmStream> stream(new PcmStream);
+                stream->open(static_cast<const sf::Int16*>(assets.data(*entry)), static_cast<std::size_t>(entry->size / sizeof(sf::Int16)),
+                             entry->channels, entry->sampleRate);
+                // Plus the mapped pages of the newest chunk, which PcmStream hasn't released yet
+                clip.residentBytes = stream->chunkBytes() * (chunksHeld + 1);
+                clip.pcm = stream.get();
+                clip.stream = std::move(stream);
+            }
+            else {
+                std::unique_ptr<sf::Music> music(new sf::Music);
+                if (!music->openFromFile(std::string(assetRoot) + clip.name)) return false;
+                clip.residentBytes = static_cast<std::size_t>(music->getSampleRate()) * music->getChannelCount() * sizeof(sf::Int16) * chunksHeld; // One-second chunks
+                clip.stream = std::move(music);
+            }
+        }
+        else {
+            std::vector<sf::Int16> compact;
+            if (entry) {
+                compact = compactEffect(static_cast<const sf::Int16*>(assets.data(*entry)), static_cast<std::size_t>(entry->size / sizeof(sf::Int16)),
+                                        entry->channels, entry->sampleRate);
+                AssetBundle::release(assets.data(*entry), static_cast<std::size_t>(entry->size)); // Copied out; the mapped pages aren't needed
+            }
+            else {
+                sf::SoundBuffer decoded;
+                if (!decoded.loadFromFile(std::string(assetRoot) + clip.name)) return false;
+                compact = compactEffect(decoded.getSamples(), static_cast<std::size_t>(decoded.getSampleCount()), decoded.getChannelCount(), decoded.getSampleRate());
+            }
+            clip.buffer.reset(new sf::SoundBuffer);
+            if (!clip.buffer->loadFromSamples(compact.data(), compact.size(), 1, effectSampleRate)) return false;
+            clip.sound.reset(new sf::Sound(*clip.buffer));
+            clip.residentBytes = compact.size() * sizeof(sf::Int16);
+        }
+        clip.loaded = true;
+        clip.lastPlayedNs = steadyNanoseconds();
+        return true;
+    }
+
+    static void unload(Clip& clip) {
+        clip.sound.reset(); // Before its buffer
+        clip.buffer.reset();
+        clip.stream.reset();
+        clip.pcm = nullptr;
+        clip.loaded = false;
+    }
+
+    std::vector<std::unique_ptr<Clip>> clips;
+    long long evictAfterNs;
+};
+
+// The build step: decode every sound once and pack it with the font into one bundle
+int packAssets(const std::string& bundlePath, std::string root) {
+    assets.close(); // Windows won't rewrite a file that is mapped
+    if (!root.empty() && root.back() != '/' && root.back() != '\\') root += '/';
+    BundleWriter writer;
+    std::vector<char> font;
+    std::ifstream fontIn(root + fontAsset, std::ios::binary);
+    font.assign(std::istreambuf_iterator<char>(fontIn), std::istreambuf_iterator<char>());
+    if (font.empty() || !writer.add(fontAsset, root + fontAsset, BundleKind::Font, font.data(), font.size())) {
+        std::cerr << "Can't pack " << root << fontAsset << "\n";
+        return 1;
+    }
+    for (const char* name : soundAssets) {
+        sf::SoundBuffer sound;
+        if (!sound.loadFromFile(root + name) ||
+            !writer.add(name, root + name, BundleKind::Sound, sound.getSamples(), static_cast<std::size_t>(sound.getSampleCount()) * sizeof(sf::Int16),
+                        sound.getChannelCount(), sound.getSampleRate())) {
+            std::cerr << "Can't pack " << root << name << "\n";
+            return 1;
+        }
+    }
+    if (!writer.write(bundlePath)) {
+        std::cerr << "Can't write " << bundlePath << "\n";
+        return 1;
+    }
+    std::cout << "Packed " << writer.entryCount() << " assets (" << writer.duplicateCount() << " duplicates stored once) into " << bundlePath << std::endl;
+    return 0;
+}
+
+const size_t spectatorHistory = 8;               // Updates kept for interpolation
+const double spectatorDelayTicks = 3.0;          // How far behind the server viewers draw, to ride out jitter
+const double spectatorMaxExtrapolationTicks = 6.0;
+
+// Paddle and balls as of one update, for interpolation on the viewer's side
+struct SpectatorSample {
+    sf::Uint32 tick = 0;
+    sf::Vector2f paddlePosition;
+    std::vector<sf::Vector2f> ballPositions;
+    std::vector<sf::Vector2f> ballVelocities;
+};
+
+// The viewer's end of a spectator stream: applies updates to its own copy of the world
+// and draws it a few ticks behind the server, blending between the updates either side
+class SpectatorClient {
+public:
+    SpectatorClient() : history(spectatorHistory) {}
+
+    bool connect(const std::string& host, unsigned short port) {
+        if (socket.connect(host, port, sf::seconds(2.0f)) != sf::Socket::Done) return false;
+        socket.setBlocking(false);
+        return true;
+    }
+
+    // Apply everything that has arrived; false once the server hangs up or sends garbage
+    bool poll() {
+        sf::Packet packet;
+        sf::Socket::Status status;
+        while ((status = socket.receive(packet)) == sf::Socket::Done) {
+            bytes += static_cast<long long>(packet.getDataSize()) + 4;
+            ++updates;
+            if (!decode(packet)) return false;
+        }
+        return status == sf::Socket::NotReady;
+    }
+
+    // Fill the snapshots and blend factor drawScene wants for the moment `now` (in seconds)
+    float sample(double now, GameSnapshot& previous, GameSnapshot& current) const {
+        current.bricks.assign(bricks.begin(), bricks.end());
+        current.score = score;
+        current.remainingBalls = remainingBalls;
+        current.level = level;
+        current.gameOver = gameOver;
+        if (samples == 0) return 0.0f;
+
+        double tick = (now + clockOffset) / frameTime - spectatorDelayTicks;
+        const SpectatorSample* before = nullptr;
+        const SpectatorSample* after = nullptr;
+        for (size_t i = 0; i < samples && i < spectatorHistory; ++i) {
+            const SpectatorSample& s = history[i];
+            if (s.tick <= tick && (!before || s.tick > before->tick)) before = &s;
+            if (s.tick > tick && (!after || s.tick < after->tick)) after = &s;
+        }
+
+        if (before && after) {
+            copySample(*before, previous, 0.0f);
+            copySample(*after, current, 0.0f);
+            return static_cast<float>((tick - before->tick) / (after->tick - before->tick));
+        }
+        if (!before) {
+            // Behind everything we have, which only happens just after joining
+            copySample(*after, previous, 0.0f);
+            copySample(*after, current, 0.0f);
+            return 1.0f;
+        }
+
+        // Past the newest update: carry the balls along their velocities for a few frames
+        float ahead = static_cast<float>(std::min(tick - before->tick, spectatorMaxExtrapolationTicks));
+        copySample(*before, previous, ahead);
+        copySample(*before, current, ahead);
+        return 1.0f;
+    }
+
+    // Where bricks were destroyed since the last call, for debris
+    std::vector<sf::Vector2f>& destroyedBricks() {
+        return destroyed;
+    }
+
+    long long bytesReceived() const {
+        return bytes;
+    }
+
+    long long updatesReceived() const {
+        return updates;
+    }
+
+private:
+    bool decode(sf::Packet& packet) {
+        sf::Uint8 flags = 0;
+        sf::Uint16 shortTick = 0;
+        if (!(packet >> flags >> shortTick)) return false;
+
+        sf::Uint32 tick;
+        if (flags & spectatorKeyframe) {
+            sf::Uint16 newLevel = 0, rows = 0;
+            if (!(packet >> tick >> newLevel >> rows)) return false;
+            alive.resize((rows * brickColumns + 7) / 8);
+            for (sf::Uint8& bits : alive) packet >> bits;
+            if (tickBefore(tick, lastTick)) {
+                samples = 0; // A new game: the old samples and clock are no use
+                synced = false;
+            }
+            level = newLevel;
+            brickRows = rows;
+            moved.clear();
+            haveKeyframe = true;
+        }
+        else {
+            if (!haveKeyframe) return false;
+            tick = lastTick + static_cast<sf::Int16>(shortTick - static_cast<sf::Uint16>(lastTick));
+        }
+        lastTick = tick;
+
+        if (flags & spectatorDestroyed) {
+            for (size_t i = 0; i < alive.size(); ++i) {
+                sf::Uint8 gone = 0;
+                packet >> gone;
+                gone &= alive[i];
+                for (int bit = 0; bit < 8; ++bit) {
+                    if (gone & (1 << bit)) destroyed.push_back(brickPosition(static_cast<int>(i) * 8 + bit));
+                }
+                alive[i] &= static_cast<sf::Uint8>(~gone);
+            }
+        }
+        if (flags & spectatorFallen) {
+            for (size_t i = 0; i < alive.size(); ++i) {
+                sf::Uint8 gone = 0;
+                packet >> gone;
+                alive[i] &= static_cast<sf::Uint8>(~gone); // Off the bottom: no debris
+            }
+        }
+        if (flags & spectatorMoved) {
+            sf::Uint16 count = 0;
+            packet >> count;
+            moved.resize(count);
+            for (MovedBrick& brick : moved) packet >> brick.slot >> brick.y;
+        }
+        if (flags & spectatorScore) {
+            sf::Int32 newScore = 0;
+            sf::Uint8 balls = 0;
+            packet >> newScore >> balls;
+            score = newScore;
+            remainingBalls = balls;
+        }
+        gameOver = (flags & spectatorGameOver) != 0;
+
+        SpectatorSample& s = history[samples++ % spectatorHistory];
+        s.tick = tick;
+        sf::Int16 paddleX = 0;
+        sf::Uint8 balls = 0;
+        packet >> paddleX >> balls;
+        s.paddlePosition = sf::Vector2f(paddleX / spectatorPositionScale, 550.0f);
+        s.ballPositions.resize(balls);
+        s.ballVelocities.resize(balls);
+        for (sf::Uint8 i = 0; i < balls; ++i) {
+            sf::Int16 x = 0, y = 0, vx = 0, vy = 0;
+            packet >> x >> y >> vx >> vy;
+            s.ballPositions[i] = sf::Vector2f(x / spectatorPositionScale, y / spectatorPositionScale);
+            s.ballVelocities[i] = sf::Vector2f(vx / spectatorVelocityScale, vy / spectatorVelocityScale);
+        }
+        if (!packet || !packet.endOfPacket()) return false;
+
+        if (flags & (spectatorKeyframe | spectatorDestroyed | spectatorFallen | spectatorMoved)) rebuildBricks();
+
+        // Track the server clock from the least delayed updates, easing back slowly so a
+        // lucky early packet doesn't set it for good
+        double now = steadyNanoseconds() / 1e9;
+        double offset = tick * static_cast<double>(frameTime) - now;
+        if (!synced || offset > clockOffset) clockOffset = offset;
+        else clockOffset += (offset - clockOffset) * 0.01;
+        synced = true;
+        return true;
+    }
+
+    sf::Vector2f brickPosition(int slot) const {
+        sf::Vector2f position = brickHome(slot);
+        for (const MovedBrick& brick : moved) {
+            if (brick.slot == slot) position.y = brick.y;
+        }
+        return position;
+    }
+
+    void rebuildBricks() {
+        bricks.clear();
+        for (int slot = 0; slot < brickRows * brickColumns; ++slot) {
+            if (alive[slot / 8] & (1 << (slot % 8))) {
+                Brick brick;
+                brick.slot = slot;
+                brick.position = brickPosition(slot);
+                brick.colorIndex = (slot / brickColumns) % 5;
+                bricks.push_back(brick);
+            }
+        }
+    }
+
+    static void copySample(const SpectatorSample& s, GameSnapshot& snapshot, float ahead) {
+        snapshot.paddlePosition = s.paddlePosition;
+        snapshot.ballPositions.clear();
+        for (size_t i = 0; i < s.ballPositions.size(); ++i) {
+            snapshot.ballPositions.push_back(s.ballPositions[i] + s.ballVelocities[i] * ahead);
+        }
+    }
+
+    sf::TcpSocket socket;
+    bool haveKeyframe = false;
+    sf::Uint32 lastTick = 0;
+    int level = 0;
+    int brickRows = 0;
+    int score = 0;
+    int remainingBalls = 0;
+    bool gameOver = false;
+    std::vector<sf::Uint8> alive;
+    std::vector<MovedBrick> moved;
+    std::vector<Brick> bricks;
+    std::vector<sf::Vector2f> destroyed;
+
+    std::vector<SpectatorSample> history;
+    size_t samples = 0;
+    bool synced = false;
+    double clockOffset = 0.0; // Server time minus ours, in seconds
+
+    long long bytes = 0;
+    long long updates = 0;
+};
+
+// Watch a game streamed by --spectator-port or --stream-ai
+int runSpectator(const std::string& host, unsigned short port) {
+    SpectatorClient client;
+    if (!client.connect(host, port)) {
+        std::cerr << "Can't reach the game at " << host << ":" << port << "\n";
+        return 1;
+    }
+
+    sf::RenderWindow window(sf::VideoMode(800, 600), "Breakout Remix - spectating");
+    window.setFramerateLimit(60);
+    sf::Font font;
+    if (!loadFont(font, fontAsset)) {
+        std::cerr << "Failed to load font!\n";
+        return -1;
+    }
+    Hud hud;
+    SfmlBackend renderer(window, font);
+    GameSnapshot previous, current;
+    auto start = std::chrono::steady_clock::now();
+
+    while (window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed)
+                window.close();
+        }
+        if (!client.poll()) {
+            std::cout << "The game stopped streaming\n";
+            break;
+        }
+
+        for (const sf::Vector2f& position : client.destroyedBricks()) {
+            spawnDebris(debris, position, brickHitDebris);
+        }
+        client.destroyedBricks().clear();
+        updateDebris(debris, debrisClock.restart().asSeconds());
+
+        float alpha = client.sample(steadyNanoseconds() / 1e9, previous, current);
+        hud.update(current.score, current.remainingBalls, current.level);
+        drawScene(renderer, previous, current, alpha, hud, nullptr, false);
+        renderer.display();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Received " << client.bytesReceived() << " bytes in " << client.updatesReceived() << " updates, "
+              << client.bytesReceived() / seconds << " bytes/s\n";
+    return 0;
+}
+
+// Stream headless AI games in real time, one after another, for spectators to watch
+int runSpectatorStream(unsigned short port, double seconds) {
+    using clock = std::chrono::steady_clock;
+    const auto tick = std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(frameTime));
+
+    SpectatorServer server(port);
+    if (!server.start()) return 1;
+
+    auto start = clock::now();
+    auto finished = [&]() {
+        return seconds > 0 && std::chrono::duration<double>(clock::now() - start).count() >= seconds;
+    };
+    AiController ai;
+    FrameEvents events;
+    while (!finished()) {
+        World world;
+        resetLevel(world);
+        auto nextTick = clock::now();
+        while (!world.gameOver && !finished()) {
+            std::this_thread::sleep_until(nextTick);
+            nextTick += tick;
+            stepWorld(world, ai.update(world), events);
+            server.publish(world);
+        }
+        std::cout << "Game over at level " << world.level << ", score " << world.score << "\n";
+        std::this_thread::sleep_for(std::chrono::seconds(2)); // Let viewers see the end
+    }
+    server.stop();
+    return 0;
+}
+
+// Many headless viewers on one stream, to see how far a server goes and what each costs
+int runSpectatorLoad(const std::string& host, unsigned short port, int clients, double seconds) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<SpectatorClient>> viewers;
+    for (int i = 0; i < clients; ++i) {
+        std::unique_ptr<SpectatorClient> viewer(new SpectatorClient);
+        if (!viewer->connect(host, port)) {
+            std::cerr << "Viewer " << i << " can't reach " << host << ":" << port << "\n";
+            break;
+        }
+        viewers.push_back(std::move(viewer));
+    }
+
+    size_t dropped = 0;
+    GameSnapshot previous, current;
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < seconds) {
+        for (auto& viewer : viewers) {
+            if (viewer && !viewer->poll()) {
+                viewer.reset();
+                ++dropped;
+            }
+            else if (viewer) {
+                viewer->destroyedBricks().clear();
+                viewer->sample(steadyNanoseconds() / 1e9, previous, current);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    long long total = 0, lowest = std::numeric_limits<long long>::max(), highest = 0, updates = 0;
+    for (auto& viewer : viewers) {
+        if (!viewer) continue;
+        total += viewer->bytesReceived();
+        updates += viewer->updatesReceived();
+        lowest = std::min(lowest, viewer->bytesReceived());
+        highest = std::max(highest, viewer->bytesReceived());
+    }
+    size_t live = viewers.size() - dropped;
+    if (live == 0) {
+        std::cerr << "No viewers stayed connected\n";
+        return 1;
+    }
+    std::cout << live << " viewers for " << elapsed << " s (" << dropped << " dropped): " << updates / elapsed / live
+              << " updates/s and " << total / elapsed / live << " bytes/s each (min " << lowest / elapsed << ", max " << highest / elapsed << ")\n";
+    return dropped == 0 ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    bool aiPlayer = false;
+    bool vsync = false;
+    unsigned frameLimit = 60; // 0 = uncapped
+    bool fractalBackground = true;
+    unsigned cores = std::thread::hardware_concurrency();
+    int backgroundThreads = cores > 3 ? static_cast<int>(cores) - 2 : 1; // Leave the update and window threads a core each
+    float backgroundBudget = 0.25f; // Share of every frame each background thread may use
+    unsigned short spectatorPort = 0; // 0 = not streaming
+    unsigned short metricsPort = 0;   // 0 = no metrics endpoint
+
+    // Assets come from the bundle when there is one: --assets <bundle> picks another
+    std::string bundlePath = assetBundleFile;
+    for (int arg = 1; arg + 1 < argc; ++arg) {
+        if (std::string(argv[arg]) == "--assets") bundlePath = argv[arg + 1];
+    }
+    // The post-build pack only runs when the game relinks, so an asset edited since
+    // then is newer than the bundle: load that one from its loose file instead
+    if (assets.open(bundlePath)) {
+        if (std::size_t stale = assets.dropStale(assetRoot)) {
+            std::cout << stale << " assets changed since " << bundlePath << " was packed; loading them from the loose files\n";
+        }
+    }
+
+    for (int arg = 1; arg < argc; ++arg) {
+        std::string option = argv[arg];
+
+        if (option == "--assets") {
+            ++arg; // Handled above
+        }
+        // Build step: --pack-assets <bundle> [asset dir]
+        if (option == "--pack-assets" && arg + 1 < argc) {
+            return packAssets(argv[arg + 1], arg + 2 < argc ? argv[arg + 2] : assetRoot);
+        }
+
+        // Headless self-play load test: --selfplay [games] [threads] [maxFrames]
+        if (option == "--selfplay") {
+            int games = arg + 1 < argc ? std::atoi(argv[arg + 1]) : 1000;
+            int threads = arg + 2 < argc ? std::atoi(argv[arg + 2]) : static_cast<int>(std::thread::hardware_concurrency());
+            long long maxFrames = arg + 3 < argc ? std::atoll(argv[arg + 3]) : 60LL * 60 * 5; // Five minutes of play
+            runSelfPlay(games, threads, maxFrames);
+            return 0;
+        }
+        // Steady-state allocation check: --bench-allocs [frames]; exits non-zero if a frame allocates
+        if (option == "--bench-allocs") {
+            long long frames = arg + 1 < argc ? std::atoll(argv[arg + 1]) : 60LL * 60 * 5;
+            return runAllocationBenchmark(frames);
+        }
+        // Fractal background: --no-background, --background-threads <n>, --background-budget <share of a frame>
+        if (option == "--no-background") {
+            fractalBackground = false;
+        }
+        if (option == "--background-threads" && arg + 1 < argc) {
+            backgroundThreads = std::atoi(argv[++arg]);
+        }
+        if (option == "--background-budget" && arg + 1 < argc) {
+            backgroundBudget = static_cast<float>(std::atof(argv[++arg]));
+        }
+        // Golden frames from the software renderer: --golden-write|--golden-check dir [frames] [every]
+        if ((option == "--golden-write" || option == "--golden-check") && arg + 1 < argc) {
+            std::string dir = argv[arg + 1];
+            long long frames = arg + 2 < argc ? std::atoll(argv[arg + 2]) : 2400;
+            int every = arg + 3 < argc ? std::max(1, std::atoi(argv[arg + 3])) : 120;
+            return runGoldenFrames(dir, frames, every, option == "--golden-check");
+        }
+        // Software rasterizer speed: --bench-raster [frames]
+        if (option == "--bench-raster") {
+            return runRasterBenchmark(arg + 1 < argc ? std::atoi(argv[arg + 1]) : 200);
+        }
+        // Ball kernel speed: --bench-balls [max balls]
+        if (option == "--bench-balls") {
+            return runBallBenchmark(arg + 1 < argc ? std::atoi(argv[arg + 1]) : 100000);
+        }
+        // Debris ECS systems, one thread against several: --bench-ecs [entities] [frames]
+        if (option == "--bench-ecs") {
+            int entities = arg + 1 < argc ? std::atoi(argv[arg + 1]) : 200000;
+            int frames = arg + 2 < argc ? std::atoi(argv[arg + 2]) : 300;
+            return runEcsBenchmark(entities, frames);
+        }
+        // Game tick timing with and without the background: --bench-background [seconds]
+        if (option == "--bench-background") {
+            double seconds = arg + 1 < argc ? std::atof(argv[arg + 1]) : 10.0;
+            return runBackgroundBenchmark(seconds, backgroundThreads, backgroundBudget);
+        }
+        // Spectators: --spectator-port <port> streams this game; --stream-ai <port> [seconds]
+        // streams headless AI games; --spectate <host> <port> watches one;
+        // --spectate-load <host> <port> [viewers] [seconds] measures a server with many viewers
+        if (option == "--spectator-port" && arg + 1 < argc) {
+            spectatorPort = static_cast<unsigned short>(std::atoi(argv[++arg]));
+        }
+        if (option == "--stream-ai" && arg + 1 < argc) {
+            double seconds = arg + 2 < argc ? std::atof(argv[arg + 2]) : 0.0;
+            return runSpectatorStream(static_cast<unsigned short>(std::atoi(argv[arg + 1])), seconds);
+        }
+        if (option == "--spectate" && arg + 2 < argc) {
+            return runSpectator(argv[arg + 1], static_cast<unsigned short>(std::atoi(argv[arg + 2])));
+        }
+        if (option == "--spectate-load" && arg + 2 < argc) {
+            int viewers = arg + 3 < argc ? std::atoi(argv[arg + 3]) : 200;
+            double seconds = arg + 4 < argc ? std::atof(argv[arg + 4]) : 10.0;
+            return runSpectatorLoad(argv[arg + 1], static_cast<unsigned short>(std::atoi(argv[arg + 2])), viewers, seconds);
+        }
+        // Prometheus metrics over HTTP, for kiosks: --metrics-port <port>
+        if (option == "--metrics-port" && arg + 1 < argc) {
+            metricsPort = static_cast<unsigned short>(std::atoi(argv[++arg]));
+        }
+        // Let the AI play in the window (attract mode)
+        if (option == "--ai") {
+            aiPlayer = true;
+        }
+        // Frame pacing: --fps <n> for high-refresh displays, --vsync, or --uncapped
+        if (option == "--fps" && arg + 1 < argc) {
+            frameLimit = static_cast<unsigned>(std::atoi(argv[++arg]));
+        }
+        if (option == "--vsync") {
+            vsync = true;
+            frameLimit = 0;
+        }
+        if (option == "--uncapped") {
+            vsync = false;
+            frameLimit = 0;
+        }
+    }
+
+    sf::RenderWindow window(sf::VideoMode(800, 600), "Breakout Remix");
+    window.setVerticalSyncEnabled(vsync);
+    window.setFramerateLimit(frameLimit);
+
+    World world;
+    resetLevel(world);
+
+    // Score
+    sf::Font font;
+    if (!loadFont(font, fontAsset)) {
+        std::cerr << "Failed to load font!\n";
+        return -1;
+    }
+    Hud hud;
+    SfmlBackend renderer(window, font);
+
+    // Sound effects
+    AudioLibrary audio;
+    const int scoreSound = audio.add(scoreSoundAsset);
+    const int loseBallSound = audio.add(loseBallSoundAsset);
+    const int hitBallSound = audio.add(hitBallSoundAsset);
+    const int ready3Sound = audio.add(ready3SoundAsset);
+    const int winSound = audio.add(winSoundAsset);
+    if (scoreSound < 0 || loseBallSound < 0 || hitBallSound < 0 || ready3Sound < 0 || winSound < 0) {
+        std::cerr << "Failed to load sound effects!\n";
+        return -1;
+    }
+    audio.printMemory(std::cout);
+
+    // Display "READY?" and sound at the start
+    audio.play(ready3Sound);
+    displayReadyMessage(renderer);
+
+    // Fractal background, drawn scaled up behind everything else
+    FractalBackground background(backgroundThreads, backgroundBudget);
+    if (fractalBackground) background.start();
+    FrameTimeStats frameTimes;
+    MetricsShard& windowMetrics = claimMetricsShard();
+    MetricsServer metricsServer(metricsPort);
+    if (metricsPort != 0) metricsServer.start();
+
+    // The simulation runs on its own thread; this thread handles input and drawing
+    SimulationLink link;
+    SpectatorServer spectators(spectatorPort);
+    if (spectatorPort != 0 && spectators.start()) link.spectators = &spectators;
+    std::thread simulation(runSimulation, std::ref(link), world, aiPlayer);
+
+    GameSnapshot previous, current;
+    current.paddlePosition = previous.paddlePosition = world.paddlePosition;
+    current.bricks = world.bricks;
+    current.score = world.score;
+    current.remainingBalls = world.remainingBalls;
+    current.level = world.level;
+
+    // Input-to-screen latency
+    long long lastInputChangedNs = 0;
+    long long latencySamples = 0;
+    double latencyTotalMs = 0, latencyMaxMs = 0;
+
+    // Game loop
+    while (window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed)
+                window.close();
+        }
+
+        // Paddle movement
+        link.setInput(sf::Keyboard::isKeyPressed(sf::Keyboard::Left), sf::Keyboard::isKeyPressed(sf::Keyboard::Right));
+
+        // Pick up the newest simulation state
+        bool newSnapshot = link.snapshots.update();
+        bool bannerShown = false;
+        if (newSnapshot) {
+            const GameSnapshot& latest = link.snapshots.readSlot();
+            std::swap(previous, current);
+            current = latest;
+
+            if (current.paddleHits > previous.paddleHits) {
+                audio.play(hitBallSound);
+            }
+            for (long long b = std::max(previous.bricksDestroyed, current.bricksDestroyed - recentBrickSlots); b < current.bricksDestroyed; ++b) {
+                audio.play(scoreSound);
+                spawnDebris(debris, current.recentBricks[b % recentBrickSlots], brickHitDebris);
+            }
+            if (current.ballsLost > previous.ballsLost) {
+                audio.play(loseBallSound);
+            }
+            if (current.gameOver) {
+                std::cout << "Game Over!" << std::endl;
+                audio.play(loseBallSound);
+                displayYouSuckMessage(renderer);
+                std::chrono::seconds(3);
+                window.close();
+                break;
+            }
+
+            // All bricks were cleared and the next level has been set up
+            if (current.levelsCleared > previous.levelsCleared) {
+                audio.reloadDropped();
+                audio.play(winSound);
+                displayYouWonMessage(renderer);
+                bannerShown = true;
+                previous = current; // Nothing to interpolate from across levels
+                link.paused = false;
+            }
+        }
+
+        // Update debris before rendering
+        sf::Time dt = debrisClock.restart();
+        float deltaTime = dt.asSeconds();
+        updateDebris(debris, deltaTime);
+
+        // Frame time, leaving out the frame a banner held up on purpose
+        if (!bannerShown) {
+            frameTimes.record(deltaTime * 1000.0);
+            if (deltaTime > 2.0f * frameTime) background.reportOverrun();
+            windowMetrics.observe(Timing::Frame, static_cast<long long>(deltaTime * 1e9));
+        }
+        windowMetrics.set(Metric::Debris, static_cast<long long>(debris.size()));
+        audio.update();
+        windowMetrics.set(Metric::AudioVoices, audio.voicesPlaying());
+        windowMetrics.set(Metric::AudioResidentBytes, static_cast<long long>(audio.residentBytes()));
+        bool backgroundChanged = fractalBackground && background.update();
+
+        // Update score display
+        hud.update(current.score, current.remainingBalls, current.level);
+
+        // Blend the last two simulation states by how far we are into the next tick
+        float alpha = std::chrono::duration<float>(std::chrono::steady_clock::now() - current.published).count() / frameTime;
+        alpha = std::min(1.0f, std::max(0.0f, alpha));
+
+        // Render
+        drawScene(renderer, previous, current, alpha, hud, fractalBackground ? &background.pixels() : nullptr, backgroundChanged);
+        renderer.display();
+
+        // The first frame showing the result of a key change closes the latency measurement
+        if (newSnapshot && current.inputChangedNs != lastInputChangedNs) {
+            lastInputChangedNs = current.inputChangedNs;
+            if (lastInputChangedNs != 0) {
+                double latencyMs = (steadyNanoseconds() - lastInputChangedNs) / 1e6;
+                latencyTotalMs += latencyMs;
+                latencyMaxMs = std::max(latencyMaxMs, latencyMs);
+                ++latencySamples;
+            }
+        }
+    }
+
+    link.running = false;
+    link.paused = false;
+    simulation.join();
+    spectators.stop();
+    metricsServer.stop();
+    background.stop();
+
+    frameTimes.print(fractalBackground ? "Frame time with the fractal background" : "Frame time");
+    if (fractalBackground) background.printStats();
+    audio.printMemory(std::cout);
+
+    if (latencySamples > 0) {
+        std::cout << "Input-to-screen latency: mean " << latencyTotalMs / latencySamples << " ms, max " << latencyMaxMs
+                  << " ms over " << latencySamples << " key changes" << std::endl;
     }
 
     return 0;
@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// Minimal 24-bit BMP writer. Every row goes straight to its final position in the
+// file, so an image far bigger than memory can be streamed out band by band and a
+// render can pick up where it stopped.
+class BmpWriter {
+public:
+    // Bytes per row on disk: 3 per pixel, padded to a multiple of 4
+    static std::uint64_t rowStride(int width) {
+        return (static_cast<std::uint64_t>(width) * 3 + 3) & ~static_cast<std::uint64_t>(3);
+    }
+
+    static std::uint64_t fileSize(int width, int height) {
+        return headerSize + rowStride(width) * static_cast<std::uint64_t>(height);
+    }
+
+    // Create the file at full size, or reopen an existing one to continue writing into it.
+    // An existing file is only reopened if it is already the right size; resumed() says
+    // whether it was, since otherwise a fresh file was created and nothing is in it yet.
+    bool open(const std::string& path, int width, int height, bool resume) {
+        this->width = width;
+        this->height = height;
+        reopened = false;
+        if (resume) {
+            file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+            if (file && file.seekg(0, std::ios::end) && static_cast<std::uint64_t>(file.tellg()) == fileSize(width, height)) {
+                reopened = true;
+                return true;
+            }
+            file.close();
+            file.clear();
+        }
+        file.open(path, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!file) return false;
+
+        writeHeader();
+
+        // Extend to the final size now, so each band is a positioned write into place
+        file.seekp(static_cast<std::streamoff>(fileSize(width, height) - 1));
+        file.put(0);
+        return static_cast<bool>(file);
+    }
+
+    // Write rows counted from the top of the image; `bgr` holds width * 3 bytes per row.
+    // BMP rows are stored bottom-up, so each row is placed at its mirrored position.
+    bool writeRows(int firstRow, int rowCount, const std::uint8_t* bgr) {
+        const std::uint64_t stride = rowStride(width);
+        const char padding[3] = { 0, 0, 0 };
+        for (int row = 0; row < rowCount; ++row) {
+            std::uint64_t offset = headerSize + stride * static_cast<std::uint64_t>(height - 1 - (firstRow + row));
+            file.seekp(static_cast<std::streamoff>(offset));
+            file.write(reinterpret_cast<const char*>(bgr + static_cast<std::size_t>(row) * width * 3), static_cast<std::streamsize>(width) * 3);
+            file.write(padding, static_cast<std::streamsize>(stride - static_cast<std::uint64_t>(width) * 3));
+        }
+        return static_cast<bool>(file);
+    }
+
+    // Make sure everything written so far is in the file, e.g. before recording a checkpoint
+    bool flush() {
+        file.flush();
+        return static_cast<bool>(file);
+    }
+
+    void close() {
+        file.close();
+    }
+
+    bool resumed() const {
+        return reopened;
+    }
+
+private:
+    static const std::uint32_t headerSize = 14 + 40; // BITMAPFILEHEADER + BITMAPINFOHEADER
+
+    void put16(std::uint16_t value) {
+        file.put(static_cast<char>(value & 0xff));
+        file.put(static_cast<char>(value >> 8));
+    }
+
+    void put32(std::uint32_t value) {
+        put16(static_cast<std::uint16_t>(value & 0xffff));
+        put16(static_cast<std::uint16_t>(value >> 16));
+    }
+
+    void writeHeader() {
+        // The size fields are only 32 bits; past 4 GB they are written as 0, which
+        // uncompressed BMP allows for the image size and most readers accept for the file size
+        std::uint64_t total = fileSize(width, height);
+        std::uint64_t image = total - headerSize;
+
+        // BITMAPFILEHEADER
+        put16(0x4d42); // "BM"
+        put32(total <= 0xffffffffu ? static_cast<std::uint32_t>(total) : 0);
+        put16(0);
+        put16(0);
+        put32(headerSize);
+
+        // BITMAPINFOHEADER
+        put32(40);
+        put32(static_cast<std::uint32_t>(width));
+        put32(static_cast<std::uint32_t>(height)); // Positive height: rows stored bottom-up
+        put16(1);  // Planes
+        put16(24); // Bits per pixel
+        put32(0);  // BI_RGB, uncompressed
+        put32(image <= 0xffffffffu ? static_cast<std::uint32_t>(image) : 0);
+        put32(2835); // 72 DPI
+        put32(2835);
+        put32(0);
+        put32(0);
+    }
+
+    std::fstream file;
+    int width = 0;
+    int height = 0;
+    bool reopened = false;
+};
+
+// Save a whole in-memory image of packed BGR rows (top row first)
+inline bool saveBmp(const std::string& path, int width, int height, const std::uint8_t* bgr) {
+    BmpWriter writer;
+    if (!writer.open(path, width, height, false)) return false;
+    bool ok = writer.writeRows(0, height, bgr) && writer.flush();
+    writer.close();
+    return ok;
+}
+
+// Load a 24-bit uncompressed BMP into packed BGR rows (top row first)
+inline bool loadBmp(const std::string& path, int& width, int& height, std::vector<std::uint8_t>& bgr) {
+    std::ifstream file(path, std::ios::binary);
+    unsigned char header[54];
+    if (!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != 'B' || header[1] != 'M') return false;
+
+    auto read32 = [&](int offset) {
+        return static_cast<std::uint32_t>(header[offset]) | static_cast<std::uint32_t>(header[offset + 1]) << 8
+            | static_cast<std::uint32_t>(header[offset + 2]) << 16 | static_cast<std::uint32_t>(header[offset + 3]) << 24;
+    };
+    std::uint32_t dataOffset = read32(10);
+    width = static_cast<std::int32_t>(read32(18));
+    std::int32_t storedHeight = static_cast<std::int32_t>(read32(22));
+    int bitsPerPixel = header[28] | header[29] << 8;
+    if (bitsPerPixel != 24 || read32(30) != 0 || width <= 0 || storedHeight == 0) return false;
+
+    // Negative height means the rows are stored top-down
+    bool bottomUp = storedHeight > 0;
+    height = bottomUp ? storedHeight : -storedHeight;
+
+    const std::uint64_t stride = BmpWriter::rowStride(width);
+    bgr.resize(static_cast<std::size_t>(width) * height * 3);
+    std::vector<char> row(static_cast<std::size_t>(stride));
+    file.seekg(dataOffset);
+    for (int y = 0; y < height; ++y) {
+        if (!file.read(row.data(), static_cast<std::streamsize>(stride))) return false;
+        int target = bottomUp ? height - 1 - y : y;
+        std::copy(row.begin(), row.begin() + static_cast<std::ptrdiff_t>(width) * 3, bgr.begin() + static_cast<std::ptrdiff_t>(target) * width * 3);
+    }
+    return true;
+}
@@ -0,0 +1,299 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Asset bundle: every font and sound in one file, so startup maps one file instead of
+// opening and parsing each asset. Layout, little-endian: a header, the entry table,
+// then the blobs, each starting on a 64-byte boundary. Fonts are stored as they are;
+// sounds are stored already decoded, as interleaved 16-bit PCM samples. Each entry
+// records the size and modification time of the file it was packed from, so a bundle
+// that is older than its sources can be spotted.
+
+enum class BundleKind : std::uint32_t { Font = 1, Sound = 2 };
+
+struct BundleHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t entryCount;
+};
+
+struct BundleEntry {
+    char name[48];           // Path the asset was packed from, e.g. "wav/win.wav"
+    BundleKind kind;
+    std::uint32_t channels;   // Sounds only
+    std::uint32_t sampleRate; // Sounds only
+    std::uint32_t reserved;
+    std::uint64_t offset;     // From the start of the file
+    std::uint64_t size;       // In bytes
+    std::uint64_t sourceSize; // Of the file it was packed from
+    std::int64_t sourceTime;  // Its modification time, in nanoseconds since 1970
+};
+
+static_assert(sizeof(BundleHeader) == 16 && sizeof(BundleEntry) == 96, "bundle layout must not depend on the compiler");
+
+const char bundleMagic[8] = { 'B', 'R', 'K', 'B', 'N', 'D', 'L', '\0' };
+const std::uint32_t bundleVersion = 2;
+const std::uint64_t bundleAlignment = 64;
+
+// Size and modification time of a file; false if it can't be read
+inline bool fileStamp(const std::string& path, std::uint64_t& size, std::int64_t& time) {
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info)) return false;
+    size = (static_cast<std::uint64_t>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    std::int64_t ticks = static_cast<std::int64_t>((static_cast<std::uint64_t>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime);
+    time = (ticks - 116444736000000000LL) * 100; // From 100 ns ticks since 1601
+#else
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) return false;
+    size = static_cast<std::uint64_t>(info.st_size);
+#ifdef __APPLE__
+    time = static_cast<std::int64_t>(info.st_mtimespec.tv_sec) * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    time = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
+
+// Collects assets and writes them out as a bundle. Identical blobs are stored once.
+class BundleWriter {
+public:
+    // False if the name doesn't fit in an entry or the source file can't be read.
+    // sourcePath is the file the data came from, stamped into the entry.
+    bool add(const std::string& name, const std::string& sourcePath, BundleKind kind, const void* data, std::size_t size, unsigned channels = 0, unsigned sampleRate = 0) {
+        if (name.size() >= sizeof(BundleEntry::name)) return false;
+        BundleEntry entry = {};
+        if (!fileStamp(sourcePath, entry.sourceSize, entry.sourceTime)) return false;
+        std::memcpy(entry.name, name.c_str(), name.size());
+        entry.kind = kind;
+        entry.channels = channels;
+        entry.sampleRate = sampleRate;
+        entry.size = size;
+
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        std::size_t blob = 0;
+        while (blob < blobs.size() && !(blobs[blob].size() == size && (size == 0 || std::memcmp(blobs[blob].data(), bytes, size) == 0))) ++blob;
+        if (blob == blobs.size()) blobs.emplace_back(bytes, bytes + size);
+        else ++duplicates;
+
+        entries.push_back(entry);
+        entryBlobs.push_back(blob);
+        return true;
+    }
+
+    bool write(const std::string& path) {
+        BundleHeader header = {};
+        std::memcpy(header.magic, bundleMagic, sizeof(header.magic));
+        header.version = bundleVersion;
+        header.entryCount = static_cast<std::uint32_t>(entries.size());
+
+        // Lay the blobs out after the table, then point each entry at its blob
+        std::vector<std::uint64_t> blobOffsets(blobs.size());
+        std::uint64_t end = sizeof(BundleHeader) + sizeof(BundleEntry) * entries.size();
+        for (std::size_t blob = 0; blob < blobs.size(); ++blob) {
+            end = align(end);
+            blobOffsets[blob] = end;
+            end += blobs[blob].size();
+        }
+        for (std::size_t entry = 0; entry < entries.size(); ++entry) entries[entry].offset = blobOffsets[entryBlobs[entry]];
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!entries.empty()) file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(BundleEntry) * entries.size()));
+        const char padding[bundleAlignment] = {};
+        std::uint64_t at = sizeof(BundleHeader) + sizeof(BundleEntry) * entries.size();
+        for (std::size_t blob = 0; blob < blobs.size(); ++blob) {
+            file.write(padding, static_cast<std::streamsize>(blobOffsets[blob] - at));
+            file.write(reinterpret_cast<const char*>(blobs[blob].data()), static_cast<std::streamsize>(blobs[blob].size()));
+            at = blobOffsets[blob] + blobs[blob].size();
+        }
+        file.flush();
+        return static_cast<bool>(file);
+    }
+
+    std::size_t entryCount() const { return entries.size(); }
+    std::size_t duplicateCount() const { return duplicates; }
+
+private:
+    static std::uint64_t align(std::uint64_t offset) {
+        return (offset + bundleAlignment - 1) & ~(bundleAlignment - 1);
+    }
+
+    std::vector<BundleEntry> entries;
+    std::vector<std::size_t> entryBlobs; // Which blob each entry uses
+    std::vector<std::vector<unsigned char>> blobs;
+    std::size_t duplicates = 0;
+};
+
+// A bundle mapped read-only into memory. Asset data is read straight from the
+// mapping, so it must stay open while anything loaded from memory still uses it.
+// Pages come in from the file as they are first read; release() hands back the ones
+// that have been copied out or played, so the mapping only holds what is in use.
+class AssetBundle {
+public:
+    AssetBundle() {}
+    AssetBundle(const AssetBundle&) = delete;
+    AssetBundle& operator=(const AssetBundle&) = delete;
+
+    ~AssetBundle() {
+        close();
+    }
+
+    // False if the file is missing or isn't a bundle this code understands
+    bool open(const std::string& path) {
+        close();
+        if (!map(path)) return false;
+        if (!valid()) {
+            close();
+            return false;
+        }
+        stale.assign(header()->entryCount, false);
+        return true;
+    }
+
+    void close() {
+        if (!base) return;
+#ifdef _WIN32
+        UnmapViewOfFile(base);
+#else
+        munmap(const_cast<unsigned char*>(base), length);
+#endif
+        base = nullptr;
+        length = 0;
+        stale.clear();
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    std::size_t size() const { return length; }
+
+    const BundleEntry* find(const char* name, BundleKind kind) const {
+        if (!base) return nullptr;
+        for (std::uint32_t i = 0; i < header()->entryCount; ++i) {
+            const BundleEntry& entry = table()[i];
+            if (!stale[i] && entry.kind == kind && std::strncmp(entry.name, name, sizeof(entry.name)) == 0) return &entry;
+        }
+        return nullptr;
+    }
+
+    // Stop serving entries whose file under root no longer matches the size and time it
+    // was packed with, so edited assets load from the loose files until the bundle is
+    // packed again. A missing file leaves its entry alone, as the bundle may be all
+    // there is. Returns how many entries were dropped.
+    std::size_t dropStale(const std::string& root) {
+        std::size_t dropped = 0;
+        for (std::uint32_t i = 0; base && i < header()->entryCount; ++i) {
+            const BundleEntry& entry = table()[i];
+            std::uint64_t size = 0;
+            std::int64_t time = 0;
+            if (stale[i] || !fileStamp(root + entry.name, size, time)) continue;
+            if (size != entry.sourceSize || time != entry.sourceTime) {
+                stale[i] = true;
+                ++dropped;
+            }
+        }
+        return dropped;
+    }
+
+    const void* data(const BundleEntry& entry) const {
+        return base + entry.offset;
+    }
+
+    // Drop the whole pages in [data, data + size) from memory. They stay mapped and are
+    // read from the file again if anything touches them. data must be in a bundle.
+    // Returns where the released pages end, which is where releasing the rest of a
+    // range read front to back should start, so no page between two calls is missed.
+    static const void* release(const void* data, std::size_t size) {
+        const std::uintptr_t page = pageSize();
+        const std::uintptr_t first = (reinterpret_cast<std::uintptr_t>(data) + page - 1) & ~(page - 1);
+        const std::uintptr_t last = (reinterpret_cast<std::uintptr_t>(data) + size) & ~(page - 1);
+        if (last <= first) return data;
+#ifdef _WIN32
+        VirtualUnlock(reinterpret_cast<void*>(first), last - first); // Trims unlocked pages from the working set
+#else
+        madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+#endif
+        return reinterpret_cast<const void*>(last);
+    }
+
+private:
+    const BundleHeader* header() const { return reinterpret_cast<const BundleHeader*>(base); }
+    const BundleEntry* table() const { return reinterpret_cast<const BundleEntry*>(base + sizeof(BundleHeader)); }
+
+    static std::uintptr_t pageSize() {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    bool map(const std::string& path) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+        if (mapping) {
+            base = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (base) length = static_cast<std::size_t>(fileSize.QuadPart);
+            CloseHandle(mapping); // The view keeps the mapping alive
+        }
+        CloseHandle(file);
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) return false;
+        struct stat info;
+        if (fstat(file, &info) == 0 && info.st_size > 0) {
+            void* view = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (view != MAP_FAILED) {
+                base = static_cast<const unsigned char*>(view);
+                length = static_cast<std::size_t>(info.st_size);
+            }
+        }
+        ::close(file);
+#endif
+        return base != nullptr;
+    }
+
+    bool valid() const {
+        if (length < sizeof(BundleHeader) || std::memcmp(header()->magic, bundleMagic, sizeof(bundleMagic)) != 0) return false;
+        if (header()->version != bundleVersion) return false;
+        std::uint64_t entryCount = header()->entryCount;
+        if (entryCount > (length - sizeof(BundleHeader)) / sizeof(BundleEntry)) return false;
+        for (std::uint64_t i = 0; i < entryCount; ++i) {
+            const BundleEntry& entry = table()[i];
+            if (entry.name[sizeof(entry.name) - 1] != '\0') return false;
+            if (entry.offset > length || entry.size > length - entry.offset) return false;
+        }
+        return true;
+    }
+
+    const unsigned char* base = nullptr;
+    std::size_t length = 0;
+    std::vector<bool> stale; // By entry, set by dropStale
+};
@@ -0,0 +1,467 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+// Small archetype entity-component-system. Entities with the same set of components
+// share an archetype, which keeps each component in its own contiguous array, so a
+// system walks plain arrays. Components are plain data (trivially copyable), moved
+// with memcpy. Adding or removing entities from inside a system goes through a
+// CommandBuffer and happens between stages, so systems never see arrays change.
+
+typedef std::uint64_t ComponentMask; // One bit per component type
+const int maxComponentTypes = 64;
+
+struct Entity {
+    std::uint32_t index = ~0u;
+    std::uint32_t generation = 0;
+};
+
+// Component type ids, handed out in order of first use
+inline std::size_t* componentSizes() {
+    static std::size_t sizes[maxComponentTypes] = {};
+    return sizes;
+}
+
+inline int registerComponent(std::size_t size) {
+    static std::atomic<int> next{ 0 };
+    int id = next++;
+    if (id >= maxComponentTypes) throw std::length_error("too many component types");
+    componentSizes()[id] = size;
+    return id;
+}
+
+template <typename T>
+int unqualifiedComponentId() {
+    static_assert(std::is_trivially_copyable<T>::value, "components are moved with memcpy");
+    static const int id = registerComponent(sizeof(T));
+    return id;
+}
+
+// const Position and Position are the same component
+template <typename T>
+int componentId() {
+    return unqualifiedComponentId<typename std::remove_cv<T>::type>();
+}
+
+template <typename... T>
+ComponentMask componentMask() {
+    ComponentMask mask = 0;
+    int expand[] = { 0, (mask |= ComponentMask(1) << componentId<T>(), 0)... };
+    (void)expand;
+    return mask;
+}
+
+// All the entities that have exactly one set of components
+class Archetype {
+public:
+    explicit Archetype(ComponentMask mask) : mask(mask) {
+        std::fill(columnIndex, columnIndex + maxComponentTypes, -1);
+        for (int id = 0; id < maxComponentTypes; ++id) {
+            if (mask & (ComponentMask(1) << id)) {
+                columnIndex[id] = static_cast<int>(columns.size());
+                columns.push_back(Column{ id, componentSizes()[id], std::vector<unsigned char>() });
+            }
+        }
+    }
+
+    ComponentMask getMask() const { return mask; }
+    std::size_t size() const { return entities.size(); }
+    const std::vector<Entity>& getEntities() const { return entities; }
+
+    template <typename T>
+    T* array() {
+        return reinterpret_cast<T*>(columns[columnIndex[componentId<T>()]].data.data());
+    }
+
+    unsigned char* component(int id, std::size_t row) {
+        Column& column = columns[columnIndex[id]];
+        return column.data.data() + row * column.size;
+    }
+
+    void reserve(std::size_t count) {
+        entities.reserve(count);
+        for (Column& column : columns) column.data.reserve(count * column.size);
+    }
+
+    // New row with undefined contents; the caller fills every component
+    std::size_t append(Entity entity) {
+        for (Column& column : columns) column.data.resize(column.data.size() + column.size);
+        entities.push_back(entity);
+        return entities.size() - 1;
+    }
+
+    // Move the last row into `row`; returns the entity that moved there, if any
+    bool remove(std::size_t row, Entity& moved) {
+        std::size_t last = entities.size() - 1;
+        for (Column& column : columns) {
+            if (row != last) std::memcpy(column.data.data() + row * column.size, column.data.data() + last * column.size, column.size);
+            column.data.resize(column.data.size() - column.size);
+        }
+        moved = entities[last];
+        entities[row] = moved;
+        entities.pop_back();
+        return row != last;
+    }
+
+    void clear() {
+        entities.clear();
+        for (Column& column : columns) column.data.clear();
+    }
+
+private:
+    struct Column {
+        int id;
+        std::size_t size;
+        std::vector<unsigned char> data;
+    };
+
+    ComponentMask mask;
+    std::vector<Column> columns;
+    int columnIndex[maxComponentTypes];
+    std::vector<Entity> entities;
+};
+
+// One component value on its way into an entity
+struct ComponentData {
+    int id;
+    const void* data;
+};
+
+// Owns every entity and archetype
+class Registry {
+public:
+    template <typename... T>
+    Entity create(const T&... components) {
+        ComponentData data[] = { ComponentData{ componentId<T>(), &components }... };
+        return createFrom(componentMask<T...>(), data, sizeof...(T));
+    }
+
+    Entity createFrom(ComponentMask mask, const ComponentData* components, std::size_t count) {
+        std::uint32_t archetypeIndex = archetypeFor(mask);
+        Archetype& archetype = *archetypes[archetypeIndex];
+        Entity entity;
+        if (!freeIndices.empty()) {
+            entity.index = freeIndices.back();
+            freeIndices.pop_back();
+        }
+        else {
+            entity.index = static_cast<std::uint32_t>(records.size());
+            records.push_back(Record());
+        }
+        Record& record = records[entity.index];
+        entity.generation = record.generation;
+        record.archetype = archetypeIndex;
+        record.row = archetype.append(entity);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::memcpy(archetype.component(components[i].id, record.row), components[i].data, componentSizes()[components[i].id]);
+        }
+        ++count_;
+        return entity;
+    }
+
+    bool alive(Entity entity) const {
+        return entity.index < records.size() && records[entity.index].generation == entity.generation && records[entity.index].archetype != noArchetype;
+    }
+
+    void destroy(Entity entity) {
+        if (!alive(entity)) return;
+        Record& record = records[entity.index];
+        Entity moved;
+        if (archetypes[record.archetype]->remove(record.row, moved)) records[moved.index].row = record.row;
+        record.archetype = noArchetype;
+        ++record.generation; // Old handles to this slot stop being alive
+        freeIndices.push_back(entity.index);
+        --count_;
+    }
+
+    template <typename T>
+    T* get(Entity entity) {
+        if (!alive(entity)) return nullptr;
+        const Record& record = records[entity.index];
+        Archetype& archetype = *archetypes[record.archetype];
+        if (!(archetype.getMask() & (ComponentMask(1) << componentId<T>()))) return nullptr;
+        return archetype.array<T>() + record.row;
+    }
+
+    // Call f(count, entities, T* arrays...) once per archetype that has every T
+    template <typename... T, typename F>
+    void eachArchetype(F&& f) {
+        const ComponentMask mask = componentMask<T...>();
+        for (auto& archetype : archetypes) {
+            if ((archetype->getMask() & mask) == mask && archetype->size() > 0) {
+                f(archetype->size(), archetype->getEntities().data(), archetype->array<T>()...);
+            }
+        }
+    }
+
+    // Call f(entity, T&...) for every entity that has every T
+    template <typename... T, typename F>
+    void each(F&& f) {
+        eachArchetype<T...>([&](std::size_t count, const Entity* entities, T*... arrays) {
+            for (std::size_t i = 0; i < count; ++i) f(entities[i], arrays[i]...);
+        });
+    }
+
+    template <typename... T, typename F>
+    void each(F&& f) const {
+        const_cast<Registry*>(this)->each<const T...>(std::forward<F>(f));
+    }
+
+    // Make room up front, so steady-state frames don't allocate
+    template <typename... T>
+    void reserve(std::size_t count) {
+        archetypes[archetypeFor(componentMask<T...>())]->reserve(count);
+        records.reserve(count);
+        freeIndices.reserve(count);
+    }
+
+    std::size_t size() const { return count_; }
+
+    void clear() {
+        for (auto& archetype : archetypes) {
+            for (const Entity& entity : archetype->getEntities()) {
+                ++records[entity.index].generation;
+                records[entity.index].archetype = noArchetype;
+                freeIndices.push_back(entity.index);
+            }
+            archetype->clear();
+        }
+        count_ = 0;
+    }
+
+private:
+    static const std::uint32_t noArchetype = ~0u;
+
+    struct Record {
+        std::uint32_t archetype = noArchetype;
+        std::uint32_t row = 0;
+        std::uint32_t generation = 0;
+    };
+
+    std::uint32_t archetypeFor(ComponentMask mask) {
+        for (std::size_t i = 0; i < archetypes.size(); ++i) {
+            if (archetypes[i]->getMask() == mask) return static_cast<std::uint32_t>(i);
+        }
+        archetypes.emplace_back(new Archetype(mask));
+        return static_cast<std::uint32_t>(archetypes.size() - 1);
+    }
+
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::vector<Record> records;
+    std::vector<std::uint32_t> freeIndices;
+    std::size_t count_ = 0;
+};
+
+// Structural changes recorded by a system while it runs, applied later in the order given
+class CommandBuffer {
+public:
+    void destroy(Entity entity) {
+        put(destroyOp);
+        put(entity);
+    }
+
+    template <typename... T>
+    void create(const T&... components) {
+        put(createOp);
+        put(componentMask<T...>());
+        put(static_cast<std::uint32_t>(sizeof...(T)));
+        int expand[] = { 0, (putComponent(components), 0)... };
+        (void)expand;
+    }
+
+    bool empty() const { return bytes.empty(); }
+
+    void reserve(std::size_t size) { bytes.reserve(size); }
+
+    void apply(Registry& registry) {
+        std::size_t at = 0;
+        while (at < bytes.size()) {
+            Op op = take<Op>(at);
+            if (op == destroyOp) {
+                registry.destroy(take<Entity>(at));
+            }
+            else {
+                ComponentMask mask = take<ComponentMask>(at);
+                std::uint32_t count = take<std::uint32_t>(at);
+                ComponentData components[maxComponentTypes];
+                for (std::uint32_t i = 0; i < count; ++i) {
+                    components[i].id = take<int>(at);
+                    components[i].data = bytes.data() + at;
+                    at += componentSizes()[components[i].id];
+                }
+                registry.createFrom(mask, components, count);
+            }
+        }
+        bytes.clear();
+    }
+
+private:
+    enum Op : unsigned char { destroyOp, createOp };
+
+    template <typename T>
+    void put(const T& value) {
+        const unsigned char* raw = reinterpret_cast<const unsigned char*>(&value);
+        bytes.insert(bytes.end(), raw, raw + sizeof(T));
+    }
+
+    template <typename T>
+    void putComponent(const T& value) {
+        put(componentId<T>());
+        put(value);
+    }
+
+    template <typename T>
+    T take(std::size_t& at) const {
+        T value;
+        std::memcpy(&value, bytes.data() + at, sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+
+    std::vector<unsigned char> bytes;
+};
+
+// Runs systems in the order they were added, except that systems which touch different
+// components go into the same stage and may run at the same time on worker threads.
+// A system that writes a component conflicts with every system that reads or writes it;
+// it goes in the stage after the last earlier system it conflicts with.
+class SystemScheduler {
+public:
+    typedef std::function<void(Registry&, CommandBuffer&)> SystemFunction;
+
+    explicit SystemScheduler(int threads = static_cast<int>(std::thread::hardware_concurrency())) : threads(std::max(1, threads)) {}
+
+    ~SystemScheduler() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) worker.join();
+    }
+
+    void add(const char* name, ComponentMask reads, ComponentMask writes, SystemFunction run) {
+        System system = { name, reads, writes, std::move(run), 0 };
+        for (const System& earlier : systems) {
+            if (conflict(earlier, system)) system.stage = std::max(system.stage, earlier.stage + 1);
+        }
+        if (system.stage >= stages.size()) stages.resize(system.stage + 1);
+        stages[system.stage].push_back(systems.size());
+        systems.push_back(std::move(system));
+        commands.resize(systems.size());
+    }
+
+    // Run every stage; with `parallel` off everything runs on the calling thread.
+    // Each stage's structural changes are applied before the next stage starts.
+    void run(Registry& registry, bool parallel) {
+        for (const std::vector<std::size_t>& stage : stages) {
+            if (parallel && threads > 1 && stage.size() > 1) {
+                runParallel(registry, stage);
+            }
+            else {
+                for (std::size_t system : stage) systems[system].run(registry, commands[system]);
+            }
+            for (std::size_t system : stage) commands[system].apply(registry);
+        }
+    }
+
+    void reserveCommands(std::size_t bytes) {
+        for (CommandBuffer& buffer : commands) buffer.reserve(bytes);
+    }
+
+    void printPlan(std::ostream& out) const {
+        for (std::size_t stage = 0; stage < stages.size(); ++stage) {
+            out << "  stage " << stage << ":";
+            for (std::size_t system : stages[stage]) out << " " << systems[system].name;
+            out << "\n";
+        }
+    }
+
+private:
+    struct System {
+        const char* name;
+        ComponentMask reads;
+        ComponentMask writes;
+        SystemFunction run;
+        std::size_t stage;
+    };
+
+    static bool conflict(const System& a, const System& b) {
+        return (a.writes & (b.reads | b.writes)) != 0 || (b.writes & a.reads) != 0;
+    }
+
+    void runParallel(Registry& registry, const std::vector<std::size_t>& stage) {
+        // Workers are started the first time they're needed and then kept
+        std::size_t wanted = std::min(static_cast<std::size_t>(threads - 1), stage.size() - 1);
+        while (workers.size() < wanted) workers.emplace_back(&SystemScheduler::workerLoop, this);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentStage = &stage;
+            currentRegistry = &registry;
+            nextSystem = 0;
+            unfinished = stage.size();
+            ++generation;
+        }
+        wake.notify_all();
+        takeSystems();
+
+        // Done once every system has run and no worker still holds on to this stage
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&]() { return unfinished == 0 && busyWorkers == 0; });
+        currentStage = nullptr;
+    }
+
+    void takeSystems() {
+        for (;;) {
+            std::size_t index = nextSystem++;
+            if (index >= currentStage->size()) return;
+            std::size_t system = (*currentStage)[index];
+            systems[system].run(*currentRegistry, commands[system]);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--unfinished == 0) finished.notify_all();
+        }
+    }
+
+    void workerLoop() {
+        unsigned long long seen = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [&]() { return stopping || (generation != seen && currentStage); });
+            if (stopping) return;
+            seen = generation;
+            ++busyWorkers;
+            lock.unlock();
+            takeSystems();
+            lock.lock();
+            if (--busyWorkers == 0) finished.notify_all();
+        }
+    }
+
+    int threads;
+    std::vector<System> systems;
+    std::vector<CommandBuffer> commands; // One per system, so systems never share a buffer
+    std::vector<std::vector<std::size_t>> stages;
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, finished;
+    const std::vector<std::size_t>* currentStage = nullptr;
+    Registry* currentRegistry = nullptr;
+    std::atomic<std::size_t> nextSystem{ 0 };
+    std::size_t unfinished = 0;
+    std::size_t busyWorkers = 0;
+    unsigned long long generation = 0;
+    bool stopping = false;
+};
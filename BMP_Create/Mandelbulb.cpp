@@ -1,71 +1,1093 @@
 #include <iostream>
 #include <SFML/Graphics.hpp>
+#include <SFML/Network.hpp>
 #include <cmath>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
+#include "BMP_Create.h"
+#include "Mandelbulb.h"
 
-// Function to map iterations to color (smooth coloring)
-sf::Color getColor(int iterations, int max_iterations, double mu) {
-    if (iterations == max_iterations) return sf::Color::Black;
-
-    float smooth_value = static_cast<float>(iterations + 1 - std::log(std::log(mu)) / std::log(2.0));
-    float hue = 360.0f * smooth_value / max_iterations;
+// Same iteration as mandelbulb(), but stops as soon as the orbit settles into a cycle.
+// Brent-style: the orbit is compared against one saved point, and the saved point
+// jumps forward at power-of-two steps so cycles of any length are caught.
+// `work` receives the number of iterations actually run.
+template <typename T>
+int mandelbulbPeriodic(T x, T y, T z, int max_iterations, float power, float tolerance, int& work) {
+    T zx = T(0.0), zy = T(0.0), zz = T(0.0);
+    T saved_x = T(0.0), saved_y = T(0.0), saved_z = T(0.0);
+    int steps = 0, stepLimit = 2;
+    int iterations = 0;
+    const T tolerance2 = T(tolerance * tolerance);
 
-    sf::Uint8 r = static_cast<sf::Uint8>(255 * std::sin(hue));
-    sf::Uint8 g = static_cast<sf::Uint8>(255 * std::cos(hue));
-    sf::Uint8 b = static_cast<sf::Uint8>(255 * std::sin(2.0 * hue));
+    while (iterations < max_iterations && (zx * zx + zy * zy + zz * zz) < T(4.0)) {
+        mandelbulbStep(zx, zy, zz, x, y, z, power);
+        ++iterations;
 
-    return sf::Color(r, g, b);
+        // Back on a point we have already visited: the orbit is periodic and never escapes
+        T dx = zx - saved_x, dy = zy - saved_y, dz = zz - saved_z;
+        if (dx * dx + dy * dy + dz * dz <= tolerance2) {
+            work = iterations;
+            return max_iterations;
+        }
+        if (++steps == stepLimit) {
+            saved_x = zx;
+            saved_y = zy;
+            saved_z = zz;
+            steps = 0;
+            stepLimit *= 2;
+        }
+    }
+    work = iterations;
+    return iterations;
 }
 
-// Function to calculate Mandelbulb with adjustable complexity (power)
-int mandelbulb(float x, float y, float z, int max_iterations, float power) {
-    float zx = 0.0f, zy = 0.0f, zz = 0.0f;
-    int iterations = 0;
+// Scalar type the kernels run in
+enum class Precision {
+    Auto,         // Pick from the pixel spacing of the view
+    Float,
+    Double,
+    DoubleDouble
+};
 
-    while (iterations < max_iterations && (zx * zx + zy * zy + zz * zz) < 4.0f) {
-        float r = std::sqrt(zx * zx + zy * zy + zz * zz);  // Radius
-        float theta = std::atan2(std::sqrt(zx * zx + zy * zy), zz);  // Polar angle
-        float phi = std::atan2(zy, zx);  // Azimuthal angle
+const char* precisionName(Precision precision) {
+    switch (precision) {
+    case Precision::Float: return "float";
+    case Precision::Double: return "double";
+    case Precision::DoubleDouble: return "double-double";
+    default: return "auto";
+    }
+}
 
-        // Mandelbulb power transformation (increased power)
-        float r_n = std::pow(r, power);  // Increase complexity with a higher power value
-        float sin_theta = std::sin(power * theta);
-        float cos_theta = std::cos(power * theta);
-        float sin_phi = std::sin(power * phi);
-        float cos_phi = std::cos(power * phi);
+// How the iteration engine may shortcut pixels
+struct RenderSettings {
+    int max_iterations = 1000;
+    float power = 10.0f;
+    bool periodicity = true;       // Stop orbits that have settled into a cycle
+    bool interiorCheck = true;     // Skip points inside the known interior ball
+    float cycleTolerance = 1e-7f;  // How close counts as "the same point" for the cycle check
+    bool marianiSilver = false;    // Only iterate rectangle borders and fill uniform insides
+    int threads = 0;               // Render threads, 0 = one per core
+    Precision precision = Precision::Auto;
+    int aaSamples = 0;             // Extra samples for each edge pixel, 0 = no antialiasing
+    float aaBudget = 0.25f;        // Largest share of the image that may get extra samples
+};
 
-        zx = r_n * sin_theta * cos_phi + x;
-        zy = r_n * sin_theta * sin_phi + y;
-        zz = r_n * cos_theta + z;
+// Work counters for one frame
+struct RenderStats {
+    long long pixels = 0;
+    long long iterations = 0;      // Iterations actually run
+    long long iterationsSaved = 0; // Iterations brute force would have run on top of that
+    long long cyclePixels = 0;
+    long long interiorPixels = 0;
+    long long filledPixels = 0;    // Pixels Mariani-Silver filled without iterating
+    long long edgePixels = 0;      // Pixels that got antialiasing samples
+    long long extraSamples = 0;
 
-        ++iterations;
+    RenderStats& operator+=(const RenderStats& other) {
+        pixels += other.pixels;
+        iterations += other.iterations;
+        iterationsSaved += other.iterationsSaved;
+        cyclePixels += other.cyclePixels;
+        interiorPixels += other.interiorPixels;
+        filledPixels += other.filledPixels;
+        edgePixels += other.edgePixels;
+        extraSamples += other.extraSamples;
+        return *this;
+    }
+};
+
+// Iterate one point with whichever shortcuts the settings allow
+template <typename T>
+int iteratePoint(T x, T y, T z, const RenderSettings& settings, T interiorRadius2, RenderStats& stats) {
+    ++stats.pixels;
+    if (settings.interiorCheck && x * x + y * y + z * z <= interiorRadius2) {
+        ++stats.interiorPixels;
+        stats.iterationsSaved += settings.max_iterations;
+        return settings.max_iterations;
+    }
+    if (settings.periodicity) {
+        int work = 0;
+        int iterations = mandelbulbPeriodic(x, y, z, settings.max_iterations, settings.power, settings.cycleTolerance, work);
+        stats.iterations += work;
+        if (work < iterations) {
+            ++stats.cyclePixels;
+            stats.iterationsSaved += iterations - work;
+        }
+        return iterations;
     }
+    int iterations = mandelbulb(x, y, z, settings.max_iterations, settings.power);
+    stats.iterations += iterations;
     return iterations;
 }
 
-int main() {
+// Camera settings for one slice. The offsets are double-double so the camera can
+// still move by a fraction of a pixel at the deepest zoom.
+struct View {
+    double zoomFactor;
+    DoubleDouble offset_x, offset_y, offset_z;
+};
+
+// Deepest zoom double-double can still resolve
+const double maxZoomFactor = 1e25;
+
+// Pick the cheapest scalar type that still resolves neighbouring pixels. Orbit values
+// are up to 2 in size, and a few spare bits keep rounding from showing up as blocks.
+Precision choosePrecision(const View& view, int width) {
+    double spacing = 3.0 / view.zoomFactor / width;
+    if (spacing > 2.0 * std::ldexp(1.0, -24 + 6)) return Precision::Float;
+    if (spacing > 2.0 * std::ldexp(1.0, -53 + 8)) return Precision::Double;
+    return Precision::DoubleDouble;
+}
+
+// Maps pixel coordinates of a view onto points of the slice. A mapping can cover a
+// band of rows starting at firstRow; y is then counted from the top of the band.
+template <typename T>
+struct SliceMapping {
+    T current_min_x, current_min_y;
+    T real_range_x, real_range_y;
+    T zz;
+    int width, height;
+    int firstRow;
+
+    SliceMapping(const View& view, int width, int height, int firstRow = 0) : width(width), height(height), firstRow(firstRow) {
+        const T min_x = T(-1.5), max_x = T(1.5);
+        const T min_y = T(-1.5), max_y = T(1.5);
+        real_range_x = (max_x - min_x) / T(view.zoomFactor);
+        real_range_y = (max_y - min_y) / T(view.zoomFactor);
+        current_min_x = toScalar<T>(view.offset_x) - real_range_x / T(2.0);
+        current_min_y = toScalar<T>(view.offset_y) - real_range_y / T(2.0);
+        zz = toScalar<T>(view.offset_z);  // This helps render a slice of the Mandelbulb
+    }
+
+    T pointX(int x) const { return current_min_x + (T(x) * real_range_x) / T(width); }
+    T pointY(int y) const { return current_min_y + (T(y + firstRow) * real_range_y) / T(height); }
+};
+
+// Everything a render thread needs to fill its part of the iteration buffer
+template <typename T>
+struct TileRenderer {
+    std::vector<int>& iterationBuffer;
+    const SliceMapping<T>& mapping;
+    const RenderSettings& settings;
+    T interiorRadius2;
+    RenderStats& stats;
+
+    int& at(int x, int y) {
+        return iterationBuffer[static_cast<size_t>(y) * mapping.width + x];
+    }
+
+    // Iterate a pixel unless an earlier rectangle already did
+    int compute(int x, int y) {
+        int& value = at(x, y);
+        if (value < 0) {
+            value = iteratePoint(mapping.pointX(x), mapping.pointY(y), mapping.zz, settings, interiorRadius2, stats);
+        }
+        return value;
+    }
+
+    // Every pixel of the rectangle [x0, x1) x [y0, y1)
+    void fill(int x0, int y0, int x1, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                compute(x, y);
+            }
+        }
+    }
+
+    // Mariani-Silver: iterate only the border of the rectangle (inclusive bounds).
+    // A border with a single iteration count is assumed to enclose nothing else
+    // and its inside is filled without iterating; otherwise split and recurse.
+    void subdivide(int x0, int y0, int x1, int y1) {
+        const int minimumSize = 6; // Below this, iterating everything is cheaper than splitting
+
+        int first = compute(x0, y0);
+        bool uniform = true;
+        for (int x = x0; x <= x1; ++x) {
+            uniform &= compute(x, y0) == first;
+            uniform &= compute(x, y1) == first;
+        }
+        for (int y = y0 + 1; y < y1; ++y) {
+            uniform &= compute(x0, y) == first;
+            uniform &= compute(x1, y) == first;
+        }
+
+        if (x1 - x0 < 2 || y1 - y0 < 2) return; // No inside left
+        if (uniform) {
+            for (int y = y0 + 1; y < y1; ++y) {
+                for (int x = x0 + 1; x < x1; ++x) {
+                    int& value = at(x, y);
+                    if (value < 0) {
+                        value = first;
+                        ++stats.filledPixels;
+                    }
+                }
+            }
+            return;
+        }
+        if (x1 - x0 <= minimumSize || y1 - y0 <= minimumSize) {
+            fill(x0 + 1, y0 + 1, x1, y1);
+            return;
+        }
+
+        // Split across the longer side; the halves share the dividing line
+        if (x1 - x0 >= y1 - y0) {
+            int xm = (x0 + x1) / 2;
+            subdivide(x0, y0, xm, y1);
+            subdivide(xm, y0, x1, y1);
+        }
+        else {
+            int ym = (y0 + y1) / 2;
+            subdivide(x0, y0, x1, ym);
+            subdivide(x0, ym, x1, y1);
+        }
+    }
+};
+
+// Compute the iteration count of every pixel of a slice in scalar type T. The image is
+// cut into tiles that worker threads take in turn, so slow tiles don't hold up the rest.
+// With rows >= 0 only that many rows from firstRow on are rendered into the buffer.
+template <typename T>
+void renderTiles(std::vector<int>& iterationBuffer, int width, int height, const View& view, const RenderSettings& settings, RenderStats& stats, int firstRow, int rows) {
+    const int bandRows = rows < 0 ? height : rows;
+    const int tileSize = 64;
+    const int tilesX = (width + tileSize - 1) / tileSize;
+    const int tilesY = (bandRows + tileSize - 1) / tileSize;
+    const int tileCount = tilesX * tilesY;
+
+    SliceMapping<T> mapping(view, width, height, firstRow);
+    T radius = T(interiorRadius(settings.power));
+
+    iterationBuffer.assign(static_cast<size_t>(width) * bandRows, -1); // -1 = not computed yet
+
+    int threadCount = settings.threads > 0 ? settings.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min(threadCount, tileCount));
+    std::vector<RenderStats> threadStats(threadCount);
+    std::atomic<int> nextTile(0);
+
+    auto worker = [&](int thread) {
+        TileRenderer<T> renderer = { iterationBuffer, mapping, settings, radius * radius, threadStats[thread] };
+        for (int tile = nextTile++; tile < tileCount; tile = nextTile++) {
+            int x0 = (tile % tilesX) * tileSize;
+            int y0 = (tile / tilesX) * tileSize;
+            int x1 = std::min(x0 + tileSize, width);
+            int y1 = std::min(y0 + tileSize, bandRows);
+            if (settings.marianiSilver) {
+                renderer.subdivide(x0, y0, x1 - 1, y1 - 1);
+            }
+            else {
+                renderer.fill(x0, y0, x1, y1);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int thread = 1; thread < threadCount; ++thread) {
+        workers.emplace_back(worker, thread);
+    }
+    worker(0);
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    for (const RenderStats& threadStat : threadStats) {
+        stats += threadStat;
+    }
+}
+
+// Render in the precision the settings ask for, or the one the zoom needs
+Precision renderIterations(std::vector<int>& iterationBuffer, int width, int height, const View& view, const RenderSettings& settings, RenderStats& stats, int firstRow = 0, int rows = -1) {
+    Precision precision = settings.precision == Precision::Auto ? choosePrecision(view, width) : settings.precision;
+    switch (precision) {
+    case Precision::Float:
+        renderTiles<float>(iterationBuffer, width, height, view, settings, stats, firstRow, rows);
+        break;
+    case Precision::Double:
+        renderTiles<double>(iterationBuffer, width, height, view, settings, stats, firstRow, rows);
+        break;
+    default:
+        renderTiles<DoubleDouble>(iterationBuffer, width, height, view, settings, stats, firstRow, rows);
+        break;
+    }
+    return precision;
+}
+
+// Deterministic pseudo-random number in [0, 1) for sample jitter, so the same
+// view always antialiases the same way
+float sampleJitter(int x, int y, int sample) {
+    unsigned h = static_cast<unsigned>(x) * 73856093u ^ static_cast<unsigned>(y) * 19349663u ^ static_cast<unsigned>(sample) * 83492791u;
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return (h & 0xffffff) / 16777216.0f;
+}
+
+// Colour every pixel from its single sample, then give pixels whose iteration count
+// differs from a neighbour extra jittered samples and average them in. Flat areas,
+// which are most of the image, cost nothing extra. Works on the same band of rows
+// the iteration buffer was rendered for.
+template <typename T>
+void antialiasTiles(std::vector<sf::Color>& colors, const std::vector<int>& iterationBuffer, int width, int height, const View& view, const RenderSettings& settings, RenderStats& stats, int firstRow, int rows) {
+    const int bandRows = rows < 0 ? height : rows;
+    SliceMapping<T> mapping(view, width, height, firstRow);
+    SliceMapping<double> colorMapping(view, width, height, firstRow);
+    T radius = T(interiorRadius(settings.power));
+
+    colors.resize(static_cast<size_t>(width) * bandRows);
+    for (int y = 0; y < bandRows; ++y) {
+        for (int x = 0; x < width; ++x) {
+            colors[static_cast<size_t>(y) * width + x] = getColor(iterationBuffer[static_cast<size_t>(y) * width + x], settings.max_iterations, colorMapping.pointX(x));
+        }
+    }
+    if (settings.aaSamples <= 0) return;
+
+    // Edge detection on the iteration buffer, remembering how big each step is
+    struct EdgePixel {
+        int x, y;
+        int contrast;
+    };
+    std::vector<EdgePixel> edges;
+    for (int y = 0; y < bandRows; ++y) {
+        for (int x = 0; x < width; ++x) {
+            int center = iterationBuffer[static_cast<size_t>(y) * width + x];
+            int contrast = 0;
+            if (x > 0) contrast = std::max(contrast, std::abs(center - iterationBuffer[static_cast<size_t>(y) * width + x - 1]));
+            if (x + 1 < width) contrast = std::max(contrast, std::abs(center - iterationBuffer[static_cast<size_t>(y) * width + x + 1]));
+            if (y > 0) contrast = std::max(contrast, std::abs(center - iterationBuffer[static_cast<size_t>(y - 1) * width + x]));
+            if (y + 1 < bandRows) contrast = std::max(contrast, std::abs(center - iterationBuffer[static_cast<size_t>(y + 1) * width + x]));
+            if (contrast > 0) edges.push_back(EdgePixel{ x, y, contrast });
+        }
+    }
+
+    // Over budget: keep the strongest edges
+    size_t budget = static_cast<size_t>(settings.aaBudget * width * bandRows);
+    if (edges.size() > budget) {
+        std::nth_element(edges.begin(), edges.begin() + budget, edges.end(),
+                         [](const EdgePixel& a, const EdgePixel& b) { return a.contrast > b.contrast; });
+        edges.resize(budget);
+    }
+
+    // Stratified jitter: one sample in each cell of a grid x grid pattern over the pixel
+    int grid = 1;
+    while ((grid + 1) * (grid + 1) <= settings.aaSamples) ++grid;
+    const int samples = grid * grid;
+
+    int threadCount = settings.threads > 0 ? settings.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, threadCount);
+    std::vector<RenderStats> threadStats(threadCount);
+    std::atomic<size_t> nextEdge(0);
+    const size_t chunk = 256;
+
+    auto worker = [&](int thread) {
+        RenderStats& local = threadStats[thread];
+        for (size_t begin = nextEdge.fetch_add(chunk); begin < edges.size(); begin = nextEdge.fetch_add(chunk)) {
+            size_t end = std::min(begin + chunk, edges.size());
+            for (size_t e = begin; e < end; ++e) {
+                const EdgePixel& edge = edges[e];
+                sf::Color first = colors[static_cast<size_t>(edge.y) * width + edge.x];
+                int r = first.r, g = first.g, b = first.b;
+
+                const int imageY = edge.y + firstRow;
+                for (int s = 0; s < samples; ++s) {
+                    double fx = edge.x - 0.5 + ((s % grid) + sampleJitter(edge.x, imageY, 2 * s)) / grid;
+                    double fy = imageY - 0.5 + ((s / grid) + sampleJitter(edge.x, imageY, 2 * s + 1)) / grid;
+                    T px = mapping.current_min_x + (T(fx) * mapping.real_range_x) / T(width);
+                    T py = mapping.current_min_y + (T(fy) * mapping.real_range_y) / T(height);
+                    int iterations = iteratePoint(px, py, mapping.zz, settings, radius * radius, local);
+
+                    sf::Color color = getColor(iterations, settings.max_iterations, static_cast<double>(px));
+                    r += color.r;
+                    g += color.g;
+                    b += color.b;
+                }
+                colors[static_cast<size_t>(edge.y) * width + edge.x] = sf::Color(
+                    static_cast<sf::Uint8>(r / (samples + 1)), static_cast<sf::Uint8>(g / (samples + 1)), static_cast<sf::Uint8>(b / (samples + 1)));
+                ++local.edgePixels;
+                local.extraSamples += samples;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int thread = 1; thread < threadCount; ++thread) {
+        workers.emplace_back(worker, thread);
+    }
+    worker(0);
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    for (const RenderStats& threadStat : threadStats) {
+        stats += threadStat;
+    }
+}
+
+// Colour the iteration buffer, antialiasing edges in the same precision it was rendered in
+void antialias(std::vector<sf::Color>& colors, const std::vector<int>& iterationBuffer, int width, int height, const View& view, Precision precision, const RenderSettings& settings, RenderStats& stats, int firstRow = 0, int rows = -1) {
+    switch (precision) {
+    case Precision::Float:
+        antialiasTiles<float>(colors, iterationBuffer, width, height, view, settings, stats, firstRow, rows);
+        break;
+    case Precision::Double:
+        antialiasTiles<double>(colors, iterationBuffer, width, height, view, settings, stats, firstRow, rows);
+        break;
+    default:
+        antialiasTiles<DoubleDouble>(colors, iterationBuffer, width, height, view, settings, stats, firstRow, rows);
+        break;
+    }
+}
+
+// Effective samples per pixel, and the time uniform supersampling at the same
+// per-edge rate would have taken (every pixel costing what the first pass did per sample)
+void printAntialiasReport(const RenderStats& stats, long long pixels, double firstPassSeconds, double aaSeconds) {
+    double uniformSamples = 1.0 + (stats.edgePixels > 0 ? static_cast<double>(stats.extraSamples) / stats.edgePixels : 0.0);
+    double uniformSeconds = firstPassSeconds * uniformSamples;
+    double adaptiveSeconds = firstPassSeconds + aaSeconds;
+
+    std::cout << "AA: " << stats.edgePixels << " edge pixels, " << stats.extraSamples << " extra samples, "
+              << static_cast<double>(pixels + stats.extraSamples) / pixels << " effective samples/pixel; "
+              << adaptiveSeconds << " s vs about " << uniformSeconds << " s for uniform " << uniformSamples << "x supersampling"
+              << " (saves " << uniformSeconds - adaptiveSeconds << " s)\n";
+}
+
+// Reference views used to check that the shortcuts change nothing
+const View referenceViews[] = {
+    { 0.5f, 0.0f, 0.0f, -2.0f },  // Start-up camera
+    { 0.5f, 0.0f, 0.0f, 0.0f },   // Slice through the middle of the bulb
+    { 2.0f, 0.3f, -0.2f, 0.1f },  // Closer in, off centre
+    { 8.0f, -0.6f, 0.5f, 0.2f },  // Deep on the boundary
+};
+
+// Subdivision fills a rectangle from its border, so a feature thinner than the border
+// spacing can be painted over. This share of a view's pixels may differ from brute force.
+const double marianiSilverTolerance = 0.0005;
+
+// Count the pixels where two renders of the same view disagree
+long long countMismatches(const std::vector<int>& expected, const std::vector<int>& actual) {
+    long long mismatches = 0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+        if (expected[i] != actual[i]) ++mismatches;
+    }
+    return mismatches;
+}
+
+// Render every reference view with and without the shortcuts and compare pixel by pixel
+// against a full brute-force render. Periodicity and the interior check must match
+// exactly; subdivision, if enabled, is checked separately against marianiSilverTolerance.
+int verifyAgainstBruteForce(int width, int height, const RenderSettings& settings) {
+    RenderSettings bruteForce = settings;
+    bruteForce.periodicity = false;
+    bruteForce.interiorCheck = false;
+    bruteForce.marianiSilver = false;
+    RenderSettings exact = settings;
+    exact.marianiSilver = false;
+    const long long allowed = static_cast<long long>(marianiSilverTolerance * width * height);
+
+    int failures = 0;
+    for (const View& view : referenceViews) {
+        std::vector<int> expected, actual;
+        RenderStats bruteStats, fastStats;
+
+        auto start = std::chrono::steady_clock::now();
+        renderIterations(expected, width, height, view, bruteForce, bruteStats);
+        auto middle = std::chrono::steady_clock::now();
+        renderIterations(actual, width, height, view, exact, fastStats);
+        auto end = std::chrono::steady_clock::now();
+
+        long long mismatches = countMismatches(expected, actual);
+        if (mismatches > 0) ++failures;
+
+        std::cout << "View zoom " << view.zoomFactor << " at (" << static_cast<double>(view.offset_x) << ", " << static_cast<double>(view.offset_y)
+                  << ", " << static_cast<double>(view.offset_z) << "): "
+                  << (mismatches == 0 ? "identical" : std::to_string(mismatches) + " pixels differ")
+                  << ", brute force " << std::chrono::duration<double>(middle - start).count() << " s"
+                  << ", shortcuts " << std::chrono::duration<double>(end - middle).count() << " s"
+                  << ", iterations saved " << fastStats.iterationsSaved << " of " << bruteStats.iterations << "\n";
+
+        if (settings.marianiSilver) {
+            RenderStats subdivisionStats;
+            start = std::chrono::steady_clock::now();
+            renderIterations(actual, width, height, view, settings, subdivisionStats);
+            end = std::chrono::steady_clock::now();
+
+            mismatches = countMismatches(expected, actual);
+            if (mismatches > allowed) ++failures;
+            std::cout << "  Mariani-Silver: " << mismatches << " pixels differ (" << allowed << " allowed"
+                      << (mismatches > allowed ? ", FAILED" : "") << "), " << std::chrono::duration<double>(end - start).count() << " s"
+                      << ", pixels filled " << subdivisionStats.filledPixels << "\n";
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+// Progress of a render to disk, kept next to the image so an interrupted render can resume.
+// Everything that changes the pixels is recorded, so a different render never picks it up.
+struct RenderCheckpoint {
+    int width = 0, height = 0;
+    View view = { 0.0, 0.0, 0.0, 0.0 };
+    int max_iterations = 0;
+    float power = 0.0f;
+    int precision = 0;
+    int aaSamples = 0;
+    float aaBudget = 0.0f;
+    int periodicity = 0;
+    int interiorCheck = 0;
+    float cycleTolerance = 0.0f;
+    int marianiSilver = 0;
+    int rowsDone = 0;
+
+    bool sameRender(const RenderCheckpoint& other) const {
+        return width == other.width && height == other.height && view.zoomFactor == other.view.zoomFactor
+            && view.offset_x == other.view.offset_x && view.offset_y == other.view.offset_y && view.offset_z == other.view.offset_z
+            && max_iterations == other.max_iterations && power == other.power && precision == other.precision
+            && aaSamples == other.aaSamples && aaBudget == other.aaBudget && periodicity == other.periodicity
+            && interiorCheck == other.interiorCheck && cycleTolerance == other.cycleTolerance && marianiSilver == other.marianiSilver;
+    }
+};
+
+bool loadCheckpoint(const std::string& path, RenderCheckpoint& checkpoint) {
+    std::ifstream file(path);
+    View& v = checkpoint.view;
+    file >> checkpoint.width >> checkpoint.height >> v.zoomFactor >> v.offset_x.hi >> v.offset_x.lo >> v.offset_y.hi >> v.offset_y.lo
+         >> v.offset_z.hi >> v.offset_z.lo >> checkpoint.max_iterations >> checkpoint.power >> checkpoint.precision
+         >> checkpoint.aaSamples >> checkpoint.aaBudget >> checkpoint.periodicity >> checkpoint.interiorCheck
+         >> checkpoint.cycleTolerance >> checkpoint.marianiSilver >> checkpoint.rowsDone;
+    return static_cast<bool>(file);
+}
+
+// Written to a temporary file and renamed over the old one, so a crash mid-write
+// leaves the previous checkpoint rather than half of a new one
+bool saveCheckpoint(const std::string& path, const RenderCheckpoint& checkpoint) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary);
+        const View& v = checkpoint.view;
+        file.precision(17);
+        file << checkpoint.width << ' ' << checkpoint.height << ' ' << v.zoomFactor << ' ' << v.offset_x.hi << ' ' << v.offset_x.lo << ' '
+             << v.offset_y.hi << ' ' << v.offset_y.lo << ' ' << v.offset_z.hi << ' ' << v.offset_z.lo << ' ' << checkpoint.max_iterations << ' '
+             << checkpoint.power << ' ' << checkpoint.precision << ' ' << checkpoint.aaSamples << ' ' << checkpoint.aaBudget << ' '
+             << checkpoint.periodicity << ' ' << checkpoint.interiorCheck << ' ' << checkpoint.cycleTolerance << ' '
+             << checkpoint.marianiSilver << ' ' << checkpoint.rowsDone << '\n';
+        if (!file.flush()) return false;
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(path.c_str()); // Windows won't rename over an existing file
+        return std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+    return true;
+}
+
+// Render an image of any size straight into a BMP file, a band of rows at a time, so
+// memory use stays within memoryMB however big the image is. After every band the
+// rows written so far are recorded; running the same render again continues from there.
+int renderToBmp(const std::string& path, int width, int height, const View& view, const RenderSettings& settings, int memoryMB) {
+    // Working memory per pixel of a band: iteration count, colour, BGR output and, at worst, an AA edge entry
+    const size_t bytesPerPixel = sizeof(int) + sizeof(sf::Color) + 3 + 3 * sizeof(int);
+    long long budgetRows = static_cast<long long>(memoryMB) * 1024 * 1024 / (static_cast<long long>(width) * bytesPerPixel);
+    const int bandRows = static_cast<int>(std::max(1LL, std::min<long long>(budgetRows - 2, height))); // 2 halo rows
+
+    // Fix the precision for the whole image so every band matches
+    RenderSettings bandSettings = settings;
+    bandSettings.precision = settings.precision == Precision::Auto ? choosePrecision(view, width) : settings.precision;
+
+    RenderCheckpoint checkpoint;
+    checkpoint.width = width;
+    checkpoint.height = height;
+    checkpoint.view = view;
+    checkpoint.max_iterations = settings.max_iterations;
+    checkpoint.power = settings.power;
+    checkpoint.precision = static_cast<int>(bandSettings.precision);
+    checkpoint.aaSamples = settings.aaSamples;
+    checkpoint.aaBudget = settings.aaBudget;
+    checkpoint.periodicity = settings.periodicity;
+    checkpoint.interiorCheck = settings.interiorCheck;
+    checkpoint.cycleTolerance = settings.cycleTolerance;
+    checkpoint.marianiSilver = settings.marianiSilver;
+
+    const std::string checkpointPath = path + ".progress";
+    RenderCheckpoint saved;
+    bool resume = loadCheckpoint(checkpointPath, saved) && saved.sameRender(checkpoint) && saved.rowsDone <= height;
+
+    BmpWriter writer;
+    if (!writer.open(path, width, height, resume)) {
+        std::cerr << "Can't write " << path << "\n";
+        return 1;
+    }
+    if (resume && writer.resumed()) {
+        checkpoint.rowsDone = saved.rowsDone;
+        std::cout << "Resuming " << path << " at row " << checkpoint.rowsDone << " of " << height << "\n";
+    }
+    else if (resume) {
+        std::cout << path << " is missing or the wrong size, so the render starts over\n";
+    }
+
+    // Band buffers are sized once for the largest band and reused
+    const size_t bandPixels = static_cast<size_t>(width) * (bandRows + 2);
+    std::vector<int> iterationBuffer;
+    std::vector<sf::Color> colors;
+    std::vector<std::uint8_t> bgr;
+    iterationBuffer.reserve(bandPixels);
+    colors.reserve(bandPixels);
+    bgr.resize(static_cast<size_t>(width) * bandRows * 3);
+
+    std::cout << "Rendering " << width << "x" << height << " (" << BmpWriter::fileSize(width, height) / (1024.0 * 1024.0) << " MB on disk) in "
+              << precisionName(bandSettings.precision) << ", bands of " << bandRows << " rows, about "
+              << bandPixels * bytesPerPixel / (1024.0 * 1024.0) << " MB working memory\n";
+
+    RenderStats stats;
+    auto start = std::chrono::steady_clock::now();
+    const int startRow = checkpoint.rowsDone;
+    for (int row = startRow; row < height; row += bandRows) {
+        const int rows = std::min(bandRows, height - row);
+
+        // One extra row above and below, so edge detection sees across band borders
+        const int haloTop = row > 0 ? 1 : 0;
+        const int haloBottom = row + rows < height ? 1 : 0;
+        const int renderRows = haloTop + rows + haloBottom;
+        renderIterations(iterationBuffer, width, height, view, bandSettings, stats, row - haloTop, renderRows);
+        antialias(colors, iterationBuffer, width, height, view, bandSettings.precision, bandSettings, stats, row - haloTop, renderRows);
+
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const sf::Color& color = colors[static_cast<size_t>(y + haloTop) * width + x];
+                std::uint8_t* pixel = &bgr[(static_cast<size_t>(y) * width + x) * 3];
+                pixel[0] = color.b;
+                pixel[1] = color.g;
+                pixel[2] = color.r;
+            }
+        }
+        if (!writer.writeRows(row, rows, bgr.data()) || !writer.flush()) {
+            std::cerr << "Write to " << path << " failed at row " << row << "\n";
+            return 1;
+        }
+        checkpoint.rowsDone = row + rows;
+        saveCheckpoint(checkpointPath, checkpoint);
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double rowsPerSecond = (checkpoint.rowsDone - startRow) / seconds;
+        std::cout << "Rows " << checkpoint.rowsDone << "/" << height << ", " << rowsPerSecond * width / 1e6 << " Mpixels/s, about "
+                  << (height - checkpoint.rowsDone) / rowsPerSecond << " s left\n";
+    }
+    writer.close();
+    std::remove(checkpointPath.c_str());
+
+    std::cout << "Wrote " << path << " in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s, "
+              << stats.iterations << " iterations, " << stats.iterationsSaved << " saved\n";
+    if (settings.aaSamples > 0) {
+        std::cout << "AA: " << stats.edgePixels << " edge pixels, " << stats.extraSamples << " extra samples\n";
+    }
+    return 0;
+}
+
+// Distributed rendering: a coordinator cuts every frame into strips of rows and hands
+// them out over TCP to worker processes, which send back run-length encoded iteration
+// counts. Strips are small so fast workers simply take more of them.
+const int stripRows = 16;
+const size_t stripsInFlight = 2;          // Per worker, so it never sits idle waiting for the next job
+const double stripDeadlineSeconds = 60.0; // A worker that takes longer than this over one strip is treated as hung
+const double animationZoomPerFrame = 1.05;
+
+// One strip of one frame, with everything a worker needs to render it
+struct StripJob {
+    sf::Uint32 frame = 0, strip = 0;
+    sf::Int32 firstRow = 0, rows = 0, width = 0, height = 0;
+    View view = { 0.0, 0.0, 0.0, 0.0 };
+    RenderSettings settings;
+};
+
+sf::Packet& operator<<(sf::Packet& packet, const DoubleDouble& value) {
+    return packet << value.hi << value.lo;
+}
+
+sf::Packet& operator>>(sf::Packet& packet, DoubleDouble& value) {
+    return packet >> value.hi >> value.lo;
+}
+
+sf::Packet& operator<<(sf::Packet& packet, const StripJob& job) {
+    const RenderSettings& s = job.settings;
+    return packet << job.frame << job.strip << job.firstRow << job.rows << job.width << job.height
+                  << job.view.zoomFactor << job.view.offset_x << job.view.offset_y << job.view.offset_z
+                  << static_cast<sf::Int32>(s.max_iterations) << s.power << s.periodicity << s.interiorCheck << s.cycleTolerance
+                  << s.marianiSilver << static_cast<sf::Int32>(s.precision);
+}
+
+sf::Packet& operator>>(sf::Packet& packet, StripJob& job) {
+    RenderSettings& s = job.settings;
+    sf::Int32 maxIterations = 0, precision = 0;
+    packet >> job.frame >> job.strip >> job.firstRow >> job.rows >> job.width >> job.height
+           >> job.view.zoomFactor >> job.view.offset_x >> job.view.offset_y >> job.view.offset_z
+           >> maxIterations >> s.power >> s.periodicity >> s.interiorCheck >> s.cycleTolerance
+           >> s.marianiSilver >> precision;
+    s.max_iterations = maxIterations;
+    s.precision = static_cast<Precision>(precision);
+    return packet;
+}
+
+// Run-length encode iteration counts as (run length, value) pairs. Escapes on the first
+// iteration, interior regions and Mariani-Silver fills all come out as long runs.
+void encodeRuns(sf::Packet& packet, const std::vector<int>& values) {
+    packet << static_cast<sf::Uint32>(values.size());
+    for (size_t i = 0; i < values.size();) {
+        size_t run = 1;
+        while (i + run < values.size() && values[i + run] == values[i]) ++run;
+        packet << static_cast<sf::Uint32>(run) << static_cast<sf::Int32>(values[i]);
+        i += run;
+    }
+}
+
+// Decode into out[0, count); false if the packet is short or doesn't describe exactly count values
+bool decodeRuns(sf::Packet& packet, int* out, size_t count) {
+    sf::Uint32 total = 0;
+    if (!(packet >> total) || total != count) return false;
+    size_t filled = 0;
+    while (filled < count) {
+        sf::Uint32 run = 0;
+        sf::Int32 value = 0;
+        if (!(packet >> run >> value) || run == 0 || run > count - filled) return false;
+        std::fill(out + filled, out + filled + run, value);
+        filled += run;
+    }
+    return true;
+}
+
+// Render strips for a coordinator until it goes away
+int runWorker(const std::string& host, unsigned short port, const RenderSettings& settings) {
+    sf::TcpSocket socket;
+
+    // Keep trying for a while, so workers can be started before the coordinator
+    int attempts = 0;
+    while (socket.connect(host, port, sf::seconds(2.0f)) != sf::Socket::Done) {
+        if (++attempts == 30) {
+            std::cerr << "Can't reach coordinator at " << host << ":" << port << "\n";
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+    std::cout << "Worker connected to " << host << ":" << port << "\n";
+
+    std::vector<int> iterationBuffer;
+    sf::Packet packet;
+    long long strips = 0;
+    double busySeconds = 0.0;
+    while (socket.receive(packet) == sf::Socket::Done) {
+        StripJob job;
+        if (!(packet >> job)) break;
+        job.settings.threads = settings.threads; // Each worker decides how many cores it uses
+
+        RenderStats stats;
+        auto start = std::chrono::steady_clock::now();
+        renderIterations(iterationBuffer, job.width, job.height, job.view, job.settings, stats, job.firstRow, job.rows);
+        busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        packet.clear();
+        packet << job.frame << job.strip << static_cast<sf::Uint64>(stats.iterations);
+        encodeRuns(packet, iterationBuffer);
+        if (socket.send(packet) != sf::Socket::Done) break;
+        ++strips;
+    }
+    std::cout << "Coordinator gone; rendered " << strips << " strips in " << busySeconds << " s\n";
+    return 0;
+}
+
+// A strip sent to a worker and not returned yet
+struct InFlightStrip {
+    sf::Uint32 strip;
+    std::chrono::steady_clock::time_point deadline;
+};
+
+// A worker as the coordinator sees it
+struct WorkerConnection {
+    sf::TcpSocket socket;
+    std::vector<InFlightStrip> inFlight; // In the order they were sent, which is the order the worker renders them
+    long long strips = 0;
+    int id = 0;
+};
+
+// Render an animation zooming in from firstView across every worker that connects on
+// port. Workers may join at any time; if one drops, or misses a strip's deadline, its
+// strips go back in the queue.
+// Frames are written as prefix0000.bmp, prefix0001.bmp, ... when a prefix is given.
+int runCoordinator(unsigned short port, int width, int height, int frames, const View& firstView, const RenderSettings& settings, const std::string& prefix) {
+    sf::TcpListener listener;
+    if (listener.listen(port) != sf::Socket::Done) {
+        std::cerr << "Can't listen on port " << port << "\n";
+        return 1;
+    }
+    std::cout << "Coordinator on port " << port << ", " << frames << " frames of " << width << "x" << height << "\n";
+
+    sf::SocketSelector selector;
+    selector.add(listener);
+    std::vector<std::unique_ptr<WorkerConnection>> workers;
+    int nextWorkerId = 1;
+
+    const int stripCount = (height + stripRows - 1) / stripRows;
+    std::vector<int> iterationBuffer(static_cast<size_t>(width) * height);
+    std::vector<sf::Color> colors;
+    std::vector<std::uint8_t> bgr;
+
+    // Pixels and seconds by the number of workers connected, to show how it scales
+    std::map<size_t, std::pair<double, double>> throughput;
+    long long totalReissued = 0;
+
+    View view = firstView;
+    for (int frame = 0; frame < frames; ++frame) {
+        StripJob job;
+        job.frame = static_cast<sf::Uint32>(frame);
+        job.width = width;
+        job.height = height;
+        job.view = view;
+        job.settings = settings;
+        job.settings.precision = settings.precision == Precision::Auto ? choosePrecision(view, width) : settings.precision;
+
+        std::deque<sf::Uint32> pending;
+        for (int strip = 0; strip < stripCount; ++strip) pending.push_back(static_cast<sf::Uint32>(strip));
+        std::vector<bool> done(stripCount, false);
+        int remaining = stripCount;
+        long long compressedBytes = 0, iterations = 0, reissued = 0;
+        auto start = std::chrono::steady_clock::now();
+
+        while (remaining > 0) {
+            // Keep every worker topped up
+            for (auto& worker : workers) {
+                while (worker->inFlight.size() < stripsInFlight && !pending.empty()) {
+                    job.strip = pending.front();
+                    job.firstRow = static_cast<sf::Int32>(job.strip) * stripRows;
+                    job.rows = std::min(stripRows, height - job.firstRow);
+                    sf::Packet packet;
+                    packet << job;
+                    if (worker->socket.send(packet) != sf::Socket::Done) break; // Picked up as a disconnect below
+                    // The worker renders its strips one after another, so a strip's clock starts
+                    // when the one ahead of it is due, not when it was sent
+                    auto now = std::chrono::steady_clock::now();
+                    auto from = worker->inFlight.empty() ? now : std::max(now, worker->inFlight.back().deadline);
+                    auto deadline = from + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(stripDeadlineSeconds));
+                    worker->inFlight.push_back(InFlightStrip{ job.strip, deadline });
+                    pending.pop_front();
+                }
+            }
+
+            // Fall through on a timeout too, so deadlines are checked while every worker is silent
+            const bool ready = selector.wait(sf::seconds(1.0f));
+            if (!ready && workers.empty()) std::cout << "Waiting for workers on port " << port << "\n";
+            const auto now = std::chrono::steady_clock::now();
+
+            if (ready && selector.isReady(listener)) {
+                std::unique_ptr<WorkerConnection> worker(new WorkerConnection);
+                if (listener.accept(worker->socket) == sf::Socket::Done) {
+                    worker->id = nextWorkerId++;
+                    selector.add(worker->socket);
+                    workers.push_back(std::move(worker));
+                    std::cout << "Worker " << workers.back()->id << " joined, " << workers.size() << " connected\n";
+                }
+            }
+
+            for (size_t i = 0; i < workers.size();) {
+                WorkerConnection& worker = *workers[i];
+                bool lost = false, hung = false;
+                if (ready && selector.isReady(worker.socket)) {
+                    sf::Packet packet;
+                    sf::Socket::Status status = worker.socket.receive(packet);
+                    if (status == sf::Socket::Done) {
+                        sf::Uint32 resultFrame = 0, strip = 0;
+                        sf::Uint64 stripIterations = 0;
+                        packet >> resultFrame >> strip >> stripIterations;
+                        auto sent = std::find_if(worker.inFlight.begin(), worker.inFlight.end(), [strip](const InFlightStrip& s) { return s.strip == strip; });
+                        if (!packet || resultFrame != job.frame || sent == worker.inFlight.end()) {
+                            lost = true; // Not something we asked this worker for
+                        }
+                        else {
+                            const int firstRow = static_cast<int>(strip) * stripRows;
+                            const int rows = std::min(stripRows, height - firstRow);
+                            lost = !decodeRuns(packet, &iterationBuffer[static_cast<size_t>(firstRow) * width], static_cast<size_t>(rows) * width);
+                            if (!lost) {
+                                worker.inFlight.erase(sent);
+                                ++worker.strips;
+                                if (!done[strip]) {
+                                    done[strip] = true;
+                                    --remaining;
+                                }
+                                compressedBytes += static_cast<long long>(packet.getDataSize());
+                                iterations += static_cast<long long>(stripIterations);
+                            }
+                        }
+                    }
+                    else if (status != sf::Socket::NotReady) {
+                        lost = true;
+                    }
+                }
+                // A worker that keeps its socket open but stops answering would otherwise hold its strips forever
+                if (!lost && !worker.inFlight.empty() && now > worker.inFlight.front().deadline) {
+                    lost = hung = true;
+                }
+
+                if (lost) {
+                    // Hand its unfinished strips out again, ahead of everything else. A hung worker
+                    // is disconnected too, so a late answer can't arrive after its strips moved on.
+                    for (const InFlightStrip& sent : worker.inFlight) pending.push_front(sent.strip);
+                    reissued += static_cast<long long>(worker.inFlight.size());
+                    std::cout << "Worker " << worker.id << (hung ? " missed a strip deadline" : " lost") << " after " << worker.strips << " strips, "
+                              << worker.inFlight.size() << " strips handed out again\n";
+                    selector.remove(worker.socket);
+                    workers.erase(workers.begin() + static_cast<std::ptrdiff_t>(i));
+                    continue;
+                }
+                ++i;
+            }
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double pixels = static_cast<double>(width) * height;
+        std::pair<double, double>& slot = throughput[workers.size()];
+        slot.first += pixels;
+        slot.second += seconds;
+        totalReissued += reissued;
+
+        std::cout << "Frame " << frame << " (zoom " << view.zoomFactor << ", " << precisionName(job.settings.precision) << "): " << workers.size() << " workers, "
+                  << seconds << " s, " << pixels / seconds / 1e6 << " Mpixels/s, " << iterations << " iterations, "
+                  << compressedBytes / 1024 << " KB received (raw " << static_cast<long long>(pixels) * 4 / 1024 << " KB)"
+                  << (reissued > 0 ? ", " + std::to_string(reissued) + " strips reissued" : "") << "\n";
+
+        if (!prefix.empty()) {
+            // Antialiasing needs neighbouring rows, which a strip doesn't have, so it runs
+            // here on the whole frame with the coordinator's threads
+            RenderStats aaStats;
+            auto aaStart = std::chrono::steady_clock::now();
+            antialias(colors, iterationBuffer, width, height, view, job.settings.precision, job.settings, aaStats);
+            if (settings.aaSamples > 0) {
+                std::cout << "  AA: " << aaStats.edgePixels << " edge pixels, " << aaStats.extraSamples << " extra samples, "
+                          << std::chrono::duration<double>(std::chrono::steady_clock::now() - aaStart).count() << " s\n";
+            }
+            bgr.resize(static_cast<size_t>(width) * height * 3);
+            for (size_t i = 0; i < colors.size(); ++i) {
+                bgr[i * 3] = colors[i].b;
+                bgr[i * 3 + 1] = colors[i].g;
+                bgr[i * 3 + 2] = colors[i].r;
+            }
+            char name[16];
+            std::snprintf(name, sizeof(name), "%04d.bmp", frame);
+            if (!saveBmp(prefix + name, width, height, bgr.data())) {
+                std::cerr << "Can't write " << prefix + name << "\n";
+            }
+        }
+
+        view.zoomFactor = std::min(view.zoomFactor * animationZoomPerFrame, maxZoomFactor);
+    }
+
+    std::cout << "Throughput by workers connected at the end of a frame:\n";
+    for (const auto& entry : throughput) {
+        std::cout << "  " << entry.first << " workers: " << entry.second.first / entry.second.second / 1e6 << " Mpixels/s\n";
+    }
+    if (totalReissued > 0) std::cout << totalReissued << " strips reissued after workers were lost or hung\n";
+    for (const auto& worker : workers) {
+        std::cout << "Worker " << worker->id << " rendered " << worker->strips << " strips\n";
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
     const int width = 1920;
     const int height = 1080;
-    const int max_iterations = 1000;
+
+    RenderSettings settings;
+    settings.max_iterations = 1000;
+    // Complexity control: Mandelbulb power (adjust for more intricate shapes)
+    settings.power = 10.0f;  // Increased power to make the shape more complex
+
+    // Camera for renders to disk; the start-up camera unless --view says otherwise
+    View fileView = { 0.5, 0.0, 0.0, -2.0 };
+
+    for (int arg = 1; arg < argc; ++arg) {
+        std::string option = argv[arg];
+        if (option == "--brute-force") {
+            settings.periodicity = false;
+            settings.interiorCheck = false;
+        }
+        if (option == "--mariani-silver") {
+            settings.marianiSilver = true;
+        }
+        if (option == "--threads" && arg + 1 < argc) {
+            settings.threads = std::atoi(argv[++arg]);
+        }
+        // Force a scalar type instead of choosing by zoom: --precision float|double|dd
+        if (option == "--precision" && arg + 1 < argc) {
+            std::string name = argv[++arg];
+            settings.precision = name == "float" ? Precision::Float : name == "double" ? Precision::Double : name == "dd" ? Precision::DoubleDouble : Precision::Auto;
+        }
+        // Edge-adaptive antialiasing: --aa [samples per edge pixel] [share of pixels]
+        if (option == "--aa") {
+            settings.aaSamples = arg + 1 < argc && argv[arg + 1][0] != '-' ? std::atoi(argv[++arg]) : 9;
+            if (arg + 1 < argc && argv[arg + 1][0] != '-') settings.aaBudget = static_cast<float>(std::atof(argv[++arg]));
+        }
+        if (option == "--cycle-tolerance" && arg + 1 < argc) {
+            settings.cycleTolerance = static_cast<float>(std::atof(argv[++arg]));
+        }
+        // Check the shortcuts against brute force on the reference views: --verify [width height]
+        if (option == "--verify") {
+            int verifyWidth = arg + 2 < argc ? std::atoi(argv[arg + 1]) : 480;
+            int verifyHeight = arg + 2 < argc ? std::atoi(argv[arg + 2]) : 270;
+            return verifyAgainstBruteForce(verifyWidth, verifyHeight, settings);
+        }
+        if (option == "--view" && arg + 4 < argc) {
+            fileView.zoomFactor = std::atof(argv[++arg]);
+            fileView.offset_x = std::atof(argv[++arg]);
+            fileView.offset_y = std::atof(argv[++arg]);
+            fileView.offset_z = std::atof(argv[++arg]);
+        }
+        // Render to a BMP file of any size in bands: --render-bmp file [width height] [memory MB]
+        if (option == "--render-bmp" && arg + 1 < argc) {
+            std::string path = argv[++arg];
+            int fileWidth = arg + 2 < argc ? std::atoi(argv[arg + 1]) : width;
+            int fileHeight = arg + 2 < argc ? std::atoi(argv[arg + 2]) : height;
+            int memoryMB = arg + 3 < argc ? std::atoi(argv[arg + 3]) : 256;
+            if (fileWidth <= 0 || fileHeight <= 0 || memoryMB <= 0) {
+                std::cerr << "Usage: --render-bmp file [width height] [memory MB], all positive; give other options first\n";
+                return 1;
+            }
+            return renderToBmp(path, fileWidth, fileHeight, fileView, settings, memoryMB);
+        }
+        // Hand an animation out to worker processes: --coordinator port [width height [frames [file prefix]]]
+        if (option == "--coordinator" && arg + 1 < argc) {
+            unsigned short port = static_cast<unsigned short>(std::atoi(argv[++arg]));
+            int animationWidth = arg + 2 < argc ? std::atoi(argv[arg + 1]) : width;
+            int animationHeight = arg + 2 < argc ? std::atoi(argv[arg + 2]) : height;
+            int frames = arg + 3 < argc ? std::atoi(argv[arg + 3]) : 10;
+            std::string prefix = arg + 4 < argc ? argv[arg + 4] : "";
+            if (animationWidth <= 0 || animationHeight <= 0 || frames <= 0) {
+                std::cerr << "Usage: --coordinator port [width height [frames [file prefix]]], sizes and frames positive; give other options first\n";
+                return 1;
+            }
+            return runCoordinator(port, animationWidth, animationHeight, frames, fileView, settings, prefix);
+        }
+        // Render strips for a coordinator: --worker host port
+        if (option == "--worker" && arg + 2 < argc) {
+            std::string host = argv[arg + 1];
+            return runWorker(host, static_cast<unsigned short>(std::atoi(argv[arg + 2])), settings);
+        }
+    }
 
     sf::RenderWindow window(sf::VideoMode(width, height), "Complex Mandelbulb Fractal");
 
     // Image to store pixel data
     sf::Image fractalImage;
     fractalImage.create(width, height, sf::Color::Black);
+    std::vector<int> iterationBuffer;
+    std::vector<sf::Color> colors;
 
     // Initial camera settings
-    float zoomFactor = 0.5f;  // Start zoomed out more to better frame the Mandelbulb
-    float min_x = -1.5f, max_x = 1.5f;
-    float min_y = -1.5f, max_y = 1.5f;
-    float min_z = -1.5f, max_z = 1.5f;
+    double zoomFactor = 0.5;  // Start zoomed out more to better frame the Mandelbulb
 
     // Camera position controls
-    float move_speed = 0.2f;  // Increased movement speed
-    float zoom_speed = 1.1f;  // Increased zoom speed
-    float offset_x = 0.0f, offset_y = 0.0f, offset_z = -2.0f;  // Start camera pulled back a little on Z-axis
-
-    // Complexity control: Mandelbulb power (adjust for more intricate shapes)
-    float power = 10.0f;  // Increased power to make the shape more complex
+    double move_speed = 0.2;  // Increased movement speed
+    double zoom_speed = 1.1;  // Increased zoom speed
+    DoubleDouble offset_x = 0.0, offset_y = 0.0, offset_z = -2.0;  // Start camera pulled back a little on Z-axis
 
     while (window.isOpen()) {
         sf::Event event;
@@ -96,41 +1118,35 @@ int main() {
 
         // Zooming with keys
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::Z)) {
-            zoomFactor *= zoom_speed;  // Zoom in
+            zoomFactor = std::min(zoomFactor * zoom_speed, maxZoomFactor);  // Zoom in, as far as double-double can resolve
         }
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::X)) {
             zoomFactor /= zoom_speed;  // Zoom out
         }
 
-        // Recalculate the bounds of the 3D space based on zoom and position
-        float real_range_x = (max_x - min_x) / zoomFactor;
-        float real_range_y = (max_y - min_y) / zoomFactor;
-        float real_range_z = (max_z - min_z) / zoomFactor;
-
-        float current_min_x = offset_x - real_range_x / 2;
-        float current_max_x = offset_x + real_range_x / 2;
-        float current_min_y = offset_y - real_range_y / 2;
-        float current_max_y = offset_y + real_range_y / 2;
-        float current_min_z = offset_z - real_range_z / 2;
-        float current_max_z = offset_z + real_range_z / 2;
-
         // Generate the Mandelbulb fractal for the current camera view
+        View view = { zoomFactor, offset_x, offset_y, offset_z };
+        RenderStats stats;
+        auto start = std::chrono::steady_clock::now();
+        Precision precision = renderIterations(iterationBuffer, width, height, view, settings, stats);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Smooth coloring, with extra samples along the edges
+        auto aaStart = std::chrono::steady_clock::now();
+        antialias(colors, iterationBuffer, width, height, view, precision, settings, stats);
+        double aaSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - aaStart).count();
         for (int y = 0; y < height; ++y) {
             for (int x = 0; x < width; ++x) {
-                // Map pixel to 3D space
-                float zx = current_min_x + (x * real_range_x) / width;
-                float zy = current_min_y + (y * real_range_y) / height;
-                float zz = offset_z;  // This helps render a slice of the Mandelbulb
-
-                // Compute Mandelbulb iteration
-                int iterations = mandelbulb(zx, zy, zz, max_iterations, power);
-
-                // Smooth coloring
-                sf::Color color = getColor(iterations, max_iterations, zx);
-                fractalImage.setPixel(x, y, color);
+                fractalImage.setPixel(x, y, colors[static_cast<size_t>(y) * width + x]);
             }
         }
 
+        std::cout << "Frame (" << precisionName(precision) << ", zoom " << zoomFactor << "): " << seconds << " s, " << stats.iterations << " iterations, " << stats.iterationsSaved << " saved ("
+                  << stats.interiorPixels << " interior, " << stats.cyclePixels << " cycling, " << stats.filledPixels << " filled pixels)\n";
+        if (settings.aaSamples > 0) {
+            printAntialiasReport(stats, width * height, seconds, aaSeconds);
+        }
+
         // Load fractal into a texture
         sf::Texture texture;
         texture.loadFromImage(fractalImage);
@@ -0,0 +1,214 @@
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <cmath>
+
+// Mandelbulb iteration and colouring, shared by the fractal viewer and the Breakout background
+
+// Function to map iterations to color (smooth coloring)
+inline sf::Color getColor(int iterations, int max_iterations, double mu) {
+    if (iterations == max_iterations) return sf::Color::Black;
+
+    float smooth_value = static_cast<float>(iterations + 1 - std::log(std::log(mu)) / std::log(2.0));
+    float hue = 360.0f * smooth_value / max_iterations;
+
+    sf::Uint8 r = static_cast<sf::Uint8>(255 * std::sin(hue));
+    sf::Uint8 g = static_cast<sf::Uint8>(255 * std::cos(hue));
+    sf::Uint8 b = static_cast<sf::Uint8>(255 * std::sin(2.0 * hue));
+
+    return sf::Color(r, g, b);
+}
+
+// Double-double: an unevaluated sum hi + lo of two doubles, giving about 106 bits
+// of mantissa for zooms far beyond what float or double can resolve
+struct DoubleDouble {
+    double hi, lo;
+
+    DoubleDouble(double value = 0.0) : hi(value), lo(0.0) {}
+    DoubleDouble(double hi, double lo) : hi(hi), lo(lo) {}
+
+    explicit operator double() const { return hi + lo; }
+};
+
+// Exact sum and product of two doubles as a double-double (Knuth / Dekker)
+inline DoubleDouble twoSum(double a, double b) {
+    double s = a + b;
+    double bb = s - a;
+    return DoubleDouble(s, (a - (s - bb)) + (b - bb));
+}
+
+inline DoubleDouble quickTwoSum(double a, double b) {
+    double s = a + b;
+    return DoubleDouble(s, b - (s - a));
+}
+
+inline DoubleDouble twoProduct(double a, double b) {
+    double p = a * b;
+    return DoubleDouble(p, std::fma(a, b, -p));
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a) {
+    return DoubleDouble(-a.hi, -a.lo);
+}
+
+inline DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+    DoubleDouble s = twoSum(a.hi, b.hi);
+    DoubleDouble t = twoSum(a.lo, b.lo);
+    s.lo += t.hi;
+    s = quickTwoSum(s.hi, s.lo);
+    s.lo += t.lo;
+    return quickTwoSum(s.hi, s.lo);
+}
+
+inline DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) {
+    return a + (-b);
+}
+
+inline DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+    DoubleDouble p = twoProduct(a.hi, b.hi);
+    p.lo += a.hi * b.lo + a.lo * b.hi;
+    return quickTwoSum(p.hi, p.lo);
+}
+
+inline DoubleDouble operator/(const DoubleDouble& a, const DoubleDouble& b) {
+    double q1 = a.hi / b.hi;
+    DoubleDouble r = a - b * q1;
+    double q2 = r.hi / b.hi;
+    r = r - b * q2;
+    double q3 = r.hi / b.hi;
+    return quickTwoSum(q1, q2) + q3;
+}
+
+inline DoubleDouble& operator+=(DoubleDouble& a, const DoubleDouble& b) { return a = a + b; }
+inline DoubleDouble& operator-=(DoubleDouble& a, const DoubleDouble& b) { return a = a - b; }
+
+inline bool operator<(const DoubleDouble& a, const DoubleDouble& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+inline bool operator<=(const DoubleDouble& a, const DoubleDouble& b) { return !(b < a); }
+inline bool operator==(const DoubleDouble& a, const DoubleDouble& b) { return a.hi == b.hi && a.lo == b.lo; }
+
+// One Newton step on top of the double square root
+inline DoubleDouble sqrt(const DoubleDouble& a) {
+    if (a.hi <= 0.0) return DoubleDouble(0.0);
+    double x = std::sqrt(a.hi);
+    return quickTwoSum(x, (a - twoProduct(x, x)).hi * 0.5 / x);
+}
+
+// Convert between the scalar types the kernels can run in
+template <typename T>
+T toScalar(const DoubleDouble& value) {
+    return static_cast<T>(static_cast<double>(value));
+}
+
+template <>
+inline DoubleDouble toScalar<DoubleDouble>(const DoubleDouble& value) {
+    return value;
+}
+
+// One Mandelbulb step z -> z^power + c in spherical form.
+// Float and double use the trigonometric formula directly.
+template <typename T>
+void mandelbulbStep(T& zx, T& zy, T& zz, T x, T y, T z, float power) {
+    using std::sqrt;
+    T r = sqrt(zx * zx + zy * zy + zz * zz);  // Radius
+    T theta = std::atan2(sqrt(zx * zx + zy * zy), zz);  // Polar angle
+    T phi = std::atan2(zy, zx);  // Azimuthal angle
+
+    // Mandelbulb power transformation (increased power)
+    T r_n = std::pow(r, T(power));  // Increase complexity with a higher power value
+    T sin_theta = std::sin(T(power) * theta);
+    T cos_theta = std::cos(T(power) * theta);
+    T sin_phi = std::sin(T(power) * phi);
+    T cos_phi = std::cos(T(power) * phi);
+
+    zx = r_n * sin_theta * cos_phi + x;
+    zy = r_n * sin_theta * sin_phi + y;
+    zz = r_n * cos_theta + z;
+}
+
+// Raise the complex number re + i*im to a positive integer power by repeated squaring
+template <typename T>
+void complexPower(T& re, T& im, int n) {
+    T result_re = T(1.0), result_im = T(0.0);
+    while (n > 0) {
+        if (n & 1) {
+            T next_re = result_re * re - result_im * im;
+            result_im = result_re * im + result_im * re;
+            result_re = next_re;
+        }
+        n >>= 1;
+        if (n > 0) {
+            T next_re = re * re - im * im;
+            im = T(2.0) * re * im;
+            re = next_re;
+        }
+    }
+    re = result_re;
+    im = result_im;
+}
+
+// Double-double has no trigonometry. For an integer power, cos/sin of power*theta and
+// power*phi are the real and imaginary parts of (cos + i sin)^power, and cos/sin of
+// theta and phi themselves are plain ratios of the coordinates.
+inline void mandelbulbStep(DoubleDouble& zx, DoubleDouble& zy, DoubleDouble& zz, DoubleDouble x, DoubleDouble y, DoubleDouble z, float power) {
+    int n = static_cast<int>(power);
+    if (static_cast<float>(n) != power || n < 1) {
+        // Fractional power: fall back to double trigonometry for the angles
+        double dx = static_cast<double>(zx), dy = static_cast<double>(zy), dz = static_cast<double>(zz);
+        mandelbulbStep(dx, dy, dz, static_cast<double>(x), static_cast<double>(y), static_cast<double>(z), power);
+        zx = dx;
+        zy = dy;
+        zz = dz;
+        return;
+    }
+
+    DoubleDouble rho2 = zx * zx + zy * zy;
+    DoubleDouble r2 = rho2 + zz * zz;
+    if (r2.hi == 0.0) {
+        zx = x;
+        zy = y;
+        zz = z;
+        return;
+    }
+    DoubleDouble rho = sqrt(rho2);
+    DoubleDouble r = sqrt(r2);
+
+    // cos(theta) + i sin(theta), theta = atan2(rho, z)
+    DoubleDouble cos_theta = zz / r, sin_theta = rho / r;
+    complexPower(cos_theta, sin_theta, n);
+
+    // cos(phi) + i sin(phi), phi = atan2(y, x)
+    DoubleDouble cos_phi = 1.0, sin_phi = 0.0;
+    if (rho.hi != 0.0) {
+        cos_phi = zx / rho;
+        sin_phi = zy / rho;
+    }
+    complexPower(cos_phi, sin_phi, n);
+
+    DoubleDouble r_n = r, unused = 0.0;
+    complexPower(r_n, unused, n);
+
+    zx = r_n * sin_theta * cos_phi + x;
+    zy = r_n * sin_theta * sin_phi + y;
+    zz = r_n * cos_theta + z;
+}
+
+// Function to calculate Mandelbulb with adjustable complexity (power)
+template <typename T>
+int mandelbulb(T x, T y, T z, int max_iterations, float power) {
+    T zx = T(0.0), zy = T(0.0), zz = T(0.0);
+    int iterations = 0;
+
+    while (iterations < max_iterations && (zx * zx + zy * zy + zz * zz) < T(4.0)) {
+        mandelbulbStep(zx, zy, zz, x, y, z, power);
+        ++iterations;
+    }
+    return iterations;
+}
+
+// Radius of a ball around the origin that lies entirely inside the set.
+// The power map scales lengths as |z|^power, so with |c| <= r - r^power the orbit
+// can never leave |z| <= r; the bound is largest at r = (1/power)^(1/(power-1)).
+inline float interiorRadius(float power) {
+    if (power <= 1.0f) return 0.0f;
+    float r = std::pow(1.0f / power, 1.0f / (power - 1.0f));
+    return r - std::pow(r, power);
+}